@@ -12,12 +12,19 @@
 #include  <Adafruit_NeoPixel.h>
 #include  "configuration.h"
 #include  "TouchMIDI_AVR_if.h"
+#include  "flash_table.h"
+#include  "product.h"
 
 #include  "i2cdevice.h"
 #include  "magicflute.h"
+#include  "profiler.h"
+#include  "parameter.h"
+#include  "midi_receiver.h"
+#include  "main_loop.h"
 
 #ifdef __AVR__
   #include <avr/power.h>
+  #include <avr/sleep.h>
 #endif
 
 /*----------------------------------------------------------------------------*/
@@ -34,6 +41,11 @@ Adafruit_NeoPixel led = Adafruit_NeoPixel(MAX_LED, NEO_PIXEL_PIN, NEO_GRB + NEO_
 /*----------------------------------------------------------------------------*/
 GlobalTimer gt;
 static MagicFlute mf;
+static MidiReceiver midiIn(mf);
+static DisplayDevice display;
+#ifdef USE_PCA9685
+static DeviceHealth ledHealth;
+#endif
 
 /*----------------------------------------------------------------------------*/
 //
@@ -47,14 +59,15 @@ void flash()
 /*----------------------------------------------------------------------------*/
 void setup()
 {
+  //  Adjustable Parameters
+  parameter_init();
+
   //  Initialize Hardware
   wireBegin();
   Serial.begin(31250);
 
-#ifdef USE_ADA88
-  ada88_init();
-  ada88_write(1);
-#endif
+  display.init();
+  display.writeLetter(1);
 
   //  Set Port
   pinMode(5,OUTPUT);          //  Amp Mute
@@ -70,13 +83,23 @@ void setup()
   MBR3110_setup();
   while(1);
 #else
-  int err = MBR3110_init(); //  enable to omit an argument
-  if ( err ){ while(1){ digitalWrite(RED_LED, HIGH); setAda88_Number(err);}}
+  //  play breath-only, touch is re-initialized in background
+  int err = mf.initTouch();
+  if ( err ){ displayError(); setAda88_Number(err);}
 #endif
 
   //  Set NeoPixel Library 
   led.begin();
   led.show(); // Initialize all pixels to 'off'
+#ifdef USE_PCA9685
+  i2cErrCode = 0;
+  for ( int i=0; i<PCA9685_CHIP_MAX; i++ ){ PCA9685_init(i);}
+  if ( i2cErrCode != 0 ){ ledHealth.goOffline();}
+#endif
+
+#ifdef USE_PROFILER
+  profiler_init();
+#endif
 
   //  Set Interrupt
   MsTimer2::set(10, flash);     // 10ms Interval Timer Interrupt
@@ -84,30 +107,20 @@ void setup()
 
   //  Opening
   for ( int i=0; i<6; i++ ){
-    while( gt.globalTime() < (i+1)*10 ){
+    while( gt.globalTime() < static_cast<uint32_t>((i+1)*10) ){
       setLed( i, 200, 180, 150 ); lightLed();
     }
     setLed( i, 0, 0, 0 );
     lightLed();
   }
 
-  //  Init Tone Generator
-  setMidiBuffer( 0xc0, 0, 0xff );
+  //  Init Tone Generator with the stored player state
+  mf.init();
 }
 /*----------------------------------------------------------------------------*/
 void loop()
 {
-  //  Global Timer 
-  generateTimer();
-
-  //  Air Pressure Sensor
-  int prs = mf.midiOutAirPressure();
-  setAda88_Number(prs);
-
-  //  Touch Sensor
-  mf.checkSixTouch();
-
-	delay(2);
+  main_loop(mf, midiIn);
 }
 /*----------------------------------------------------------------------------*/
 //
@@ -119,40 +132,44 @@ int analogDataRead( void )
   return analogRead(0);
 }
 /*----------------------------------------------------------------------------*/
+int midiRxRead( void )
+{
+  return ( Serial.available() > 0 )? Serial.read():-1;
+}
+/*----------------------------------------------------------------------------*/
+void idleSleep( void )
+{
+#ifdef __AVR__
+  //  wakes up by any interrupt ( Timer0: 1msec, MsTimer2, Serial )
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  sleep_mode();
+#endif
+}
+/*----------------------------------------------------------------------------*/
 void displayError( void )
 {
   digitalWrite(RED_LED, HIGH);
 }
 /*----------------------------------------------------------------------------*/
-//
-//     Global Timer
-//
-/*----------------------------------------------------------------------------*/
-void generateTimer( void )
+void indicateAlive( bool on )
 {
-  uint32_t diff = gt.readGlobalTimeAndClear();
-
-  gt.clearAllTimerEvent();
-  gt.updateTimer(diff);
-//  setAda88_Number(diff);
-
-  if ( gt.timer100msecEvent() == true ){
-    mf.periodic100msec();
-
-    // blink LED
-    (gt.timer100ms() & 0x0002)? digitalWrite(GREEN_LED, HIGH):digitalWrite(GREEN_LED, LOW);
-  }
+#ifndef PROFILER_GPIO_GREEN
+  digitalWrite(GREEN_LED, on? HIGH:LOW);
+#endif
 }
 /*----------------------------------------------------------------------------*/
 //
 //     MIDI Command & UI
 //
 /*----------------------------------------------------------------------------*/
-void setMidiBuffer( uint8_t dt0, uint8_t dt1, uint8_t dt2 )
+void midiTxWrite( uint8_t dt )
 {
-  Serial.write(dt0);
-  Serial.write(dt1);
-  if ( dt2 != 0xff ) Serial.write(dt2);
+  Serial.write(dt);
+}
+/*----------------------------------------------------------------------------*/
+int midiTxRoom( void )
+{
+  return Serial.availableForWrite();
 }
 /*----------------------------------------------------------------------------*/
 void setMute( bool mute )
@@ -171,16 +188,18 @@ void setMute( bool mute )
 /*----------------------------------------------------------------------------*/
 void setAda88_Number( int number )
 {
-#ifdef USE_ADA88
-  ada88_writeNumber(number);  // -1999 - 1999
-#endif
+  //  skip I2C transfer if not changed
+  static int lastNumber = 0x7fff;
+  if ( number == lastNumber ){ return;}
+  lastNumber = number;
+  display.writeNumber(number);  // -1999 - 1999
 }
 /*----------------------------------------------------------------------------*/
 //
 //     Blink LED by NeoPixel Library
 //
 /*----------------------------------------------------------------------------*/
-const uint8_t colorTable[16][3] = {
+const FlashTable<uint8_t,3> colorTable[16] PROGMEM = {
   { 200,   0,   0 },//  C
   { 175,  30,   0 },
   { 155,  50,   0 },//  D
@@ -204,8 +223,44 @@ uint8_t colorTbl( uint8_t doremi, uint8_t rgb ){ return colorTable[doremi][rgb];
 void setLed( int ledNum, uint8_t red, uint8_t green, uint8_t blue )
 {
   led.setPixelColor(ledNum,led.Color(red, green, blue));
+#ifdef USE_PCA9685
+  //  the same color on the full color LEDs, only the shadow is changed
+  if ( ledNum < PCA9685_CHIP_MAX*4 ){
+    unsigned short color[3] = { static_cast<unsigned short>(red<<4), static_cast<unsigned short>(green<<4),
+                                static_cast<unsigned short>(blue<<4) };
+    PCA9685_setFullColorLED(ledNum/4, ledNum%4, color);
+  }
+#endif
 }
 void lightLed( void )
 {
   led.show();
 }
+void flushLed( void )
+{
+#ifdef USE_PCA9685
+  //  offline: the shadow keeps changes, re-initialized chips are written all
+  if ( ledHealth.online() == false ){
+    if ( ledHealth.retryNow() == false ){ return;}
+    i2cErrCode = 0;
+    for ( int i=0; i<PCA9685_CHIP_MAX; i++ ){ PCA9685_init(i);}
+    if ( i2cErrCode != 0 ){ ledHealth.retryFailed(); return;}
+    ledHealth.recovered();
+  }
+  for ( int i=0; i<PCA9685_CHIP_MAX; i++ ){
+    if ( PCA9685_flush(i) != 0 ){ ledHealth.fail(); return;}
+  }
+  ledHealth.succeed();
+#endif
+}
+/*----------------------------------------------------------------------------*/
+uint8_t* putOutputDeviceState( uint8_t* buf )
+{
+#ifdef USE_ADA88
+  buf = display.health().put(buf, DEV_ID_DISPLAY);
+#endif
+#ifdef USE_PCA9685
+  buf = ledHealth.put(buf, DEV_ID_LED);
+#endif
+  return buf;
+}
@@ -13,74 +13,110 @@
 #define TOUCH_MIDI_AVR_IF_H
  
 #include <Arduino.h>
+#ifdef __AVR__
+  #include <util/atomic.h>
+#endif
 
 int analogDataRead( void );
+int midiRxRead( void );       //  -1 when empty
+void idleSleep( void );       //  until any interrupt
 void displayError( void );
+void indicateAlive( bool on );
 void setAda88_Number( int );
+void midiTxWrite( uint8_t dt );   //  waits while TX buffer is full
+int midiTxRoom( void );           //  free bytes of TX buffer
 void setMidiBuffer( uint8_t dt0, uint8_t dt1, uint8_t dt2 );
+void clearMidiRunningStatus( void );
+void setMidiBufferLowPriority( uint8_t dt0, uint8_t dt1, uint8_t dt2 );
+void flushMidiLowPriority( void );
+void setMidiRealtime( uint8_t dt );
+uint32_t midiLowPriorityMaxWait( void );   //  [usec], cleared by reading
+void setMidiSysEx( const uint8_t* data, int length );   //  without F0/F7
+#define MIDI_LOW_PRIORITY_MAX   16
+//  static RAM of midi_output.cpp: running status, the low priority
+//  queue with 32bit stamps, its top, count and max wait
+#define MIDI_OUTPUT_RAM   (1 + MIDI_LOW_PRIORITY_MAX*(3+4) + 1 + 1 + 4)
 void setMute( bool mute );
+uint8_t* putOutputDeviceState( uint8_t* buf );   //  display and LED driver of the device report
 
 //  for NeoPixel
 uint8_t colorTbl( uint8_t index, uint8_t rgb );
 void setLed( int ledNum, uint8_t red, uint8_t green, uint8_t blue );
 void lightLed( void );
+void flushLed( void );        //  once a 10msec frame, for LED drivers on I2C
 
 
+//  _globalTime is a monotonic 10msec tick counted by ISR, and never cleared.
+//  Every reader takes an atomic snapshot, and event generation works on
+//  the difference of snapshots, so no tick is lost even after a long stall.
+//  The snapshot restores SREG, so it may be taken with interrupts disabled.
+//  A start tick other than 0 is for host tests of the wrap around.
 class GlobalTimer {
 
 public:
-  GlobalTimer( void ) : _globalTime(0), _timer100msec(0), _timer100msec_sabun(0),
-                        _timer1sec(0), _timer1sec_sabun(0), _timer10msec_event(false),
-                        _timer100msec_event(false), _timer1sec_event(false) {}
+  GlobalTimer( uint32_t start=0 ) : _timer10msec_event(false), _timer100msec_event(false), _timer1sec_event(false),
+                        _globalTime(start), _lastTick(start), _timer10msec(0), _timer100msec(0),
+                        _timer100msec_sabun(0), _timer1sec(0), _timer1sec_sabun(0) {}
 
-  void      incGlobalTime( void ){ _globalTime++;}
-  uint32_t  readGlobalTimeAndClear( void )
+  void      incGlobalTime( void ){ _globalTime++;}    //  call from ISR only
+  uint32_t  globalTime( void ) const
   {
-    noInterrupts();
-    uint32_t tm = _globalTime;
-    _globalTime = 0;
-    interrupts();
+    uint32_t tm;
+#ifdef __AVR__
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){ tm = _globalTime;}
+#else
+    tm = _globalTime;
+#endif
     return tm;
   }
-  void      setTimer100ms( uint16_t tm ){ _timer100msec = tm;}
+  uint32_t  timestampUs( void ) const { return micros();}
+  void      setTimer100ms( uint32_t tm ){ _timer100msec = tm;}
   uint32_t  timer10ms( void ) const { return _timer10msec;}
   uint32_t  timer100ms( void ) const { return _timer100msec;}
   uint32_t  timer1s( void ) const { return _timer1sec;}
-  uint8_t   globalTime( void ) const { return _globalTime;}
 
   void      clearAllTimerEvent( void ){ _timer10msec_event = _timer100msec_event = _timer1sec_event = false;}
   bool      timer10msecEvent( void ) const { return _timer10msec_event;}
   bool      timer100msecEvent( void ) const { return _timer100msec_event;}
   bool      timer1secEvent( void ) const { return _timer1sec_event;}
-  
-  void      updateTimer( uint32_t diff )
+
+  //  call once per loop, return elapsed ticks
+  uint32_t  updateTimer( void )
   {
+    const uint32_t now = globalTime();
+    const uint32_t diff = now - _lastTick;   //  safe for wrap around
+    _lastTick = now;
+
+    clearAllTimerEvent();
     if ( diff > 0 ){
       _timer10msec += diff;
       _timer10msec_event = true;
     }
 
-    _timer100msec_sabun += (uint16_t)diff;
-    while ( _timer100msec_sabun > 10 ){
-      _timer100msec++;
+    //  each event fires once per call, counters catch up at once
+    _timer100msec_sabun += diff;
+    if ( _timer100msec_sabun >= 10 ){
+      _timer100msec += _timer100msec_sabun/10;
+      _timer100msec_sabun %= 10;
       _timer100msec_event = true;
-      _timer100msec_sabun -= 10;
     }
-    _timer1sec_sabun += (uint16_t)diff;
-    while ( _timer1sec_sabun > 100 ){
-      _timer1sec++;
+    _timer1sec_sabun += diff;
+    if ( _timer1sec_sabun >= 100 ){
+      _timer1sec += _timer1sec_sabun/100;
+      _timer1sec_sabun %= 100;
       _timer1sec_event = true;
-      _timer1sec_sabun -= 100;
     }
+    return diff;
   }
 
+private:
+
   bool      _timer10msec_event;
   bool      _timer100msec_event;
   bool      _timer1sec_event;
 
-private:
-
-  volatile uint8_t  _globalTime;
+  volatile uint32_t  _globalTime;
+  uint32_t  _lastTick;
   uint32_t  _timer10msec;
   uint32_t  _timer100msec;
   uint32_t  _timer100msec_sabun;
@@ -13,52 +13,99 @@
 #include "configuration.h"
 #include "i2cdevice.h"
 #include "TouchMIDI_AVR_if.h"
+#include "parameter.h"
+#include "trace.h"
+#include "profiler.h"
 
-
-const uint8_t AirPressure::pressureToMidiTable[130] =
-{
-  0,18,29,36,42,47,51,54,57,60,
-  62,65,67,69,70,72,74,75,77,78,
-  79,80,82,83,84,85,86,87,88,88,
-  89,90,91,92,92,93,94,95,95,96,
-  97,97,98,98,99,100,100,101,101,102,
-  102,103,103,104,104,105,105,106,106,106,
-  107,107,108,108,109,109,109,110,110,110,
-  111,111,112,112,112,113,113,113,114,114,
-  114,115,115,115,116,116,116,116,117,117,
-  117,118,118,118,118,119,119,119,119,120,
-  120,120,121,121,121,121,121,122,122,122,
-  122,123,123,123,123,124,124,124,124,124,
-  125,125,125,125,126,126,126,126,126,127
-};
+//-------------------------------------------------------------------------
+//  Adjustable Value
+#define   ZERO_OFFSET         prm(PRM_ZERO_OFFSET)
+#define   MIDI_EXP_ITP_STEP   prm(PRM_MIDI_EXP_ITP_STEP)
+#define   STABLE_COUNT        prm(PRM_STABLE_COUNT)         // *10msec
+#define   NOISE_WIDTH         prm(PRM_NOISE_WIDTH)
 
 /*----------------------------------------------------------------------------*/
-const uint8_t  AirPressure::ZERO_OFFSET = 8;
-const int AirPressure::MIDI_EXP_ITP_STEP = 8;
-const int AirPressure::STABLE_COUNT = 200;          // *10msec = 2sec
+const int AirPressure::PRS_PER_INDEX = 10;         //  raw sensor count per former table index
+const int AirPressure::EXP14_MIN_DIFF = 32;         //  1/4 of 7bit resolution
+const int AirPressure::EXP_ITP_SHIFT = 1;           //  half of the distance a tick
 const int AirPressure::PWRON_DEAD_BAND_TIME = 120;  // *10msec = 1.2sec
-const int AirPressure::NOISE_WIDTH = 5;
+const int AirPressure::RESTORED_DEAD_BAND_TIME = 20;  // *10msec = 200msec
+const int AirPressure::BASE_FRAC_BITS = 8;
+const int AirPressure::BASE_SLOW_SHIFT = 6;         //  time constant: 64*10msec
+const int AirPressure::BASE_FAST_SHIFT = 2;         //  time constant: 4*10msec
+const int AirPressure::NOISE_AV_SHIFT = 4;
+const int AirPressure::CALIB_MIN_PEAK = 20*PRS_PER_INDEX;
+const int AirPressure::ATTACK_SAMPLES = PRS_ATTACK_SAMPLES;   //  less than MOVING_AV_MAX
+const int32_t AirPressure::ATTACK_TIME_US = 10000;  //  slope is scaled to this time
+const int AirPressure::ATTACK_SLOPE_SHIFT = 2;      //  raw count 380 / 10msec -> 127
+const int AirPressure::VELOCITY_MIN = 32;
+const int AirPressure::TONGUE_DIP_MIN = 4*PRS_PER_INDEX;
+const int AirPressure::TONGUE_MAX_SAMPLES = prsSamples(60000, 1);  //  60msec ( 24 of AP4 )
+const int AirPressure::TONGUE_LEVEL_SHIFT = 2;
 
 /*----------------------------------------------------------------------------*/
 //
 //     Get Air Presure
 //
 /*----------------------------------------------------------------------------*/
-int AirPressure::getPressure( void )
+int AirPressure::getPressure( bool idle )
 {
+  //  FIFO: read once a sample period, an empty FIFO wastes a transfer
+  //  idle: loop() wakes every 1msec, keep the spacing of the awake loop
+  const uint16_t elapsed = static_cast<uint16_t>(micros()) - _lastReadTime;
+  if ((( PRS_SAMPLE_MAX > 1 ) || ( idle == true )) && ( elapsed < PRS_SAMPLE_PERIOD_US )){
+    return _lastPressure;
+  }
+  //  a step of the period keeps the rate on the 1msec grid of wake up
+  if (( elapsed >= PRS_SAMPLE_PERIOD_US ) && ( elapsed - PRS_SAMPLE_PERIOD_US < PRS_SAMPLE_PERIOD_US )){
+    _lastReadTime += PRS_SAMPLE_PERIOD_US;
+  }
+  else { _lastReadTime += elapsed;}
+
+  int sample[PRS_SAMPLE_MAX];
+  uint8_t num = _sensor.readSamples(sample, PRS_SAMPLE_MAX);
+  if (( num == 0 ) && ( _sensor.online() == false )){
+    //  no breath while recovering, fingering still works
+    sample[0] = _currentStandard;
+    num = 1;
+  }
+#ifdef USE_BREATH_VIBRATO
+  const uint16_t tm = static_cast<uint16_t>(millis());
+#endif
+
   //  Pressure Sensor Moving Avarage
-  for ( int i=0; i<MOVING_AV_MAX-1; i++ ){
-    _movingAv[i] = _movingAv[i+1];
+  for ( uint8_t n=0; n<num; n++ ){
+    for ( int i=0; i<MOVING_AV_MAX-1; i++ ){
+      _movingAv[i] = _movingAv[i+1];
+    }
+    _movingAv[MOVING_AV_MAX-1] = sample[n];
+    TRACE_PRESSURE(sample[n]);
+    detectTonguing(sample[n]);
+#ifdef USE_BREATH_VIBRATO
+    PROF_BEGIN(PROF_VIBRATO);
+    if ( (_lastSentExp>>7) == 0 ){ _vibrato.reset();}
+    else {
+      //  samples of a FIFO burst are older by the sensor's period
+      _vibrato.addSample(sample[n], tm - static_cast<uint16_t>(static_cast<uint32_t>(num-1-n)*PRS_SAMPLE_PERIOD_US/1000));
+    }
+    PROF_END(PROF_VIBRATO);
+#endif
   }
-  _movingAv[MOVING_AV_MAX-1] = ap4_getAirPressure(); // analogDataRead();
 
-  int total = 0;
+  int32_t total = 0;
   for ( int i=0; i<MOVING_AV_MAX; i++ ){
     total += _movingAv[i];
   }
-  _lastPressure = total/MOVING_AV_MAX;
+  _lastPressure = static_cast<int>(total/MOVING_AV_MAX);
   return _lastPressure;
 }
+//-------------------------------------------------------------------------
+//  The latest raw sample is out of the noise, loop() must not stay idle
+//-------------------------------------------------------------------------
+bool AirPressure::breathSensed( void ) const
+{
+  return _movingAv[MOVING_AV_MAX-1] > _currentStandard + NOISE_WIDTH;
+}
 /*----------------------------------------------------------------------------*/
 //
 //     Generate MIDI Event
@@ -73,6 +120,13 @@ bool AirPressure::generateExpEvent( uint8_t* midiValue )
     *midiValue = 0;
     _afterStartCounter++;
     _currentStandard = _lastPressure;
+    if (( _afterStartCounter >= PWRON_DEAD_BAND_TIME ) && ( _restoredStandard != 0 )){
+      //  blowing at power on, the saved one is better
+      if ( _lastPressure - _restoredStandard > NOISE_WIDTH*2 ){
+        _currentStandard = _restoredStandard;
+      }
+    }
+    _baseline = static_cast<int32_t>(_currentStandard) << BASE_FRAC_BITS;
     return false;
   }
 
@@ -81,75 +135,183 @@ bool AirPressure::generateExpEvent( uint8_t* midiValue )
   //  Analyse & Generate Standard Pressure
   analyseStandardPressure(currentPrs);
 
-  //  Generate MIDI Value
+  //  Generate MIDI Value (14bit)
   int diff = currentPrs - _currentStandard;
   if ( diff < ZERO_OFFSET ){ diff = 0;}
-  else if ( diff >= INPUT_INDEX_MAX + ZERO_OFFSET ){ diff = INPUT_INDEX_MAX-1;}
   else { diff -= ZERO_OFFSET;}
+  if ( _calibrating == true ){ calibrateCurve(diff);}
+  if ( diff > BreathCurve::INPUT_SPAN-1 ){ diff = BreathCurve::INPUT_SPAN-1;}
 
-  uint8_t md = pressureToMidiTable[diff];
-  uint8_t expr = _lastMidiValue;
+  uint16_t md = _curve.exp14(static_cast<uint16_t>(diff));
+  uint16_t expr = _lastExpValue;
 
-  if ( md != _lastMidiValue ){
+  if ( md != _lastExpValue ){
     //  interpolate MIDI value
     expr = interpolateMidiExp(md);
-    _lastMidiValue = expr;
-    ret = true;
+    if (( (expr>>7) != (_lastSentExp>>7) ) ||
+        ( expr >= _lastSentExp + EXP14_MIN_DIFF ) || ( expr + EXP14_MIN_DIFF <= _lastSentExp )){
+      if (( (_lastSentExp>>7) == 0 ) && ( (expr>>7) != 0 )){
+        //  Note On will be generated
+        _attackVelocity = detectAttackVelocity();
+      }
+      _lastSentExp = expr;
+      ret = true;
+    }
   }
 
-set_ret:
   //  output
-  *midiValue = expr;
+  *midiValue = static_cast<uint8_t>(_lastSentExp>>7);
   return ret;
 }
 //-------------------------------------------------------------------------
+//  Standard pressure saved at the last power on
+//-------------------------------------------------------------------------
+void AirPressure::restoreStandardPressure( int prs )
+{
+  _restoredStandard = prs;
+  _afterStartCounter = PWRON_DEAD_BAND_TIME - RESTORED_DEAD_BAND_TIME;
+}
+//-------------------------------------------------------------------------
+//  Velocity from the slope of the latest raw samples
+//-------------------------------------------------------------------------
+uint8_t AirPressure::detectAttackVelocity( void ) const
+{
+  int slope = _movingAv[MOVING_AV_MAX-1] - _movingAv[MOVING_AV_MAX-1-ATTACK_SAMPLES];
+  if ( slope < 0 ){ slope = 0;}
+
+  //  ATTACK_SAMPLES of a slow sensor span more than ATTACK_TIME_US
+  const int32_t span = static_cast<int32_t>(ATTACK_SAMPLES)*PRS_SAMPLE_PERIOD_US;
+  if ( span != ATTACK_TIME_US ){
+    slope = static_cast<int>(static_cast<int32_t>(slope)*ATTACK_TIME_US/span);
+  }
+
+  int vel = VELOCITY_MIN + (slope >> ATTACK_SLOPE_SHIFT);
+  if ( vel > 127 ){ vel = 127;}
+  return static_cast<uint8_t>(vel);
+}
+//-------------------------------------------------------------------------
+//  Tonguing: short dip and recover of the raw pressure while sounding
+//-------------------------------------------------------------------------
+void AirPressure::detectTonguing( int rawPrs )
+{
+  if ( (_lastSentExp>>7) == 0 ){
+    _tongueLevel = rawPrs;
+    _dipCounter = 0;
+    return;
+  }
+
+  int depth = (_tongueLevel - _currentStandard)/2;
+  if ( depth < TONGUE_DIP_MIN ){ depth = TONGUE_DIP_MIN;}
+
+  if ( _dipCounter == 0 ){
+    if ( rawPrs < _tongueLevel - depth ){
+      //  dip has started
+      _dipCounter = 1;
+    }
+    else {
+      _tongueLevel += (rawPrs - _tongueLevel) >> TONGUE_LEVEL_SHIFT;
+    }
+  }
+  else if ( rawPrs > _tongueLevel - depth/4 ){
+    //  recovered soon
+    _dipCounter = 0;
+    _tongued = true;
+    _attackVelocity = detectAttackVelocity();
+  }
+  else if ( ++_dipCounter > TONGUE_MAX_SAMPLES ){
+    //  not tonguing, but phrasing
+    _dipCounter = 0;
+    _tongueLevel = rawPrs;
+  }
+}
+//-------------------------------------------------------------------------
+bool AirPressure::tonguingEvent( void )
+{
+  bool ev = _tongued;
+  _tongued = false;
+  return ev;
+}
+//-------------------------------------------------------------------------
+//  Breath Curve
+//-------------------------------------------------------------------------
+void AirPressure::changeCurve( int step )
+{
+  int num = (_curve.number() + step + BreathCurve::CURVE_MAX) % BreathCurve::CURVE_MAX;
+  _curve.select(num);
+
+  //  player's curve is made by the next breath
+  _calibrating = ( num == BreathCurve::CURVE_PLAYER )? true:false;
+  _peakDiff = 0;
+}
+//-------------------------------------------------------------------------
+void AirPressure::calibrateCurve( int diff )
+{
+  if ( diff > _peakDiff ){
+    _peakDiff = diff;
+  }
+  else if (( diff == 0 ) && ( _peakDiff > CALIB_MIN_PEAK )){
+    //  the breath has finished
+    _curve.calibrate(_peakDiff);
+    _calibrating = false;
+  }
+}
+//-------------------------------------------------------------------------
+//  Dual-rate tracking of the standard pressure
+//    - above the noise band : player is blowing, even very softly, keep
+//                             the standard
+//    - below the standard   : sensor drifted down, rebase fast
+//    - inside the noise band: follow thermal drift slowly, and rebase fast
+//                             downward after STABLE_COUNT quiet ticks
+//  called on 10msec tick, so the counts do not depend on the sensor rate
+//-------------------------------------------------------------------------
 void AirPressure::analyseStandardPressure( int crntPrs )
 {
-  //  not to mistake when blowing
-  if ( _currentStandard+NOISE_WIDTH*2 < crntPrs ){
-    _samePressureCounter = 0;   
+  const int32_t dev = (static_cast<int32_t>(crntPrs) << BASE_FRAC_BITS) - _baseline;
+  const int32_t noiseBand = static_cast<int32_t>(NOISE_WIDTH) << BASE_FRAC_BITS;
+
+  //  not to mistake when blowing: a pianissimo breath is above the noise
+  //  band too, and slow tracking would absorb it in a second
+  if ( dev > noiseBand ){
+    _quietCounter = 0;
     return;
   }
 
-  //  Analize Standard Pressure
-  if ( _newProposedPressure+NOISE_WIDTH < crntPrs ){
-    _samePressureCounter = 0;
-    _newProposedPressure = crntPrs - NOISE_WIDTH;
+  //  Noise Estimation
+  const int32_t absDev = ( dev < 0 )? -dev:dev;
+  _noise += (absDev - _noise) >> NOISE_AV_SHIFT;
+
+  if ( dev < -noiseBand ){
+    _baseline += (dev + (1<<(BASE_FAST_SHIFT-1))) >> BASE_FAST_SHIFT;
   }
-  else if ( _newProposedPressure-NOISE_WIDTH > crntPrs ){
-    _samePressureCounter = 0;
-    _newProposedPressure = crntPrs + NOISE_WIDTH;
+  else if (( _quietCounter < STABLE_COUNT ) || ( dev > 0 )){
+    //  the rise of a soft breath passes through the band, rebasing fast
+    //  there would take it from the breath
+    if ( _quietCounter < STABLE_COUNT ){ _quietCounter++;}
+    _baseline += (dev + (1<<(BASE_SLOW_SHIFT-1))) >> BASE_SLOW_SHIFT;
   }
   else {
-    _samePressureCounter++;
-    if ( _samePressureCounter > STABLE_COUNT ){
-      _samePressureCounter = 0;
-      if ( _currentStandard != _newProposedPressure ){
-        //if (_dbg) _dbg->printf("<<Change Standard Pressure=%d>>\n",_newProposedPressure);
-        _currentStandard = _newProposedPressure;
-      }
-    }
+    _baseline += (dev + (1<<(BASE_FAST_SHIFT-1))) >> BASE_FAST_SHIFT;
   }
+
+  _currentStandard = static_cast<int>(_baseline >> BASE_FRAC_BITS);
 }
 //-------------------------------------------------------------------------
-uint8_t AirPressure::interpolateMidiExp( uint8_t realExp )
+uint16_t AirPressure::interpolateMidiExp( uint16_t realExp )
 {
-  if ( realExp > _lastMidiValue ){
-    if ( _lastMidiValue < 127 - MIDI_EXP_ITP_STEP ){
-      if ( realExp > _lastMidiValue + MIDI_EXP_ITP_STEP ){
-        realExp = _lastMidiValue + MIDI_EXP_ITP_STEP;
-      }
-    }
-  }
-  else {  // realExp < _lastMidiValue
-    if ( _lastMidiValue > MIDI_EXP_ITP_STEP ){
-      if ( realExp < _lastMidiValue - MIDI_EXP_ITP_STEP ){
-        realExp = _lastMidiValue - MIDI_EXP_ITP_STEP;
-      }
-    }
+  //  first order approach in 14bit: half of the distance a tick, at most
+  //  MIDI_EXP_ITP_STEP of 7bit, and at least the resolution to be sent,
+  //  so a swell lands on its level in fine steps
+  const uint16_t maxStep = MIDI_EXP_ITP_STEP*129;
+  const bool up = ( realExp > _lastExpValue );
+  const uint16_t dist = up? realExp - _lastExpValue:_lastExpValue - realExp;
+  uint16_t step = dist >> EXP_ITP_SHIFT;
+  if ( step > maxStep ){ step = maxStep;}
+  if ( step < EXP14_MIN_DIFF ){ step = EXP14_MIN_DIFF;}
+  if ( step < dist ){
+    realExp = up? _lastExpValue + step:_lastExpValue - step;
   }
-  //  never come when realExp == _lastMidiValue
+  //  never come when realExp == _lastExpValue
 
-  _lastMidiValue = realExp;
+  _lastExpValue = realExp;
   return realExp;
 }
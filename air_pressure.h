@@ -13,45 +13,110 @@
 #define AIR_PRESSURE_H
 
 #include <Arduino.h>
+#include "breath_curve.h"
+#include "product.h"
+#include "vibrato.h"
 
-#define MOVING_AV_MAX 16
+#define PRS_SAMPLE_MAX PressureDevice::SAMPLE_MAX   //  by one sensor access
+#define PRS_SAMPLE_PERIOD_US PressureDevice::SAMPLE_PERIOD_US  //  [usec] between samples
+
+//  sample counts are set by time, so a slow FIFO sensor behaves the same
+constexpr int prsSamples( uint32_t us, int min )
+{
+  return ( us/PRS_SAMPLE_PERIOD_US > static_cast<uint32_t>(min) )? static_cast<int>(us/PRS_SAMPLE_PERIOD_US):min;
+}
+#define PRS_ATTACK_SAMPLES  prsSamples(10000, 1)                      //  10msec ( 4 of AP4 )
+#define MOVING_AV_MAX       prsSamples(40000, PRS_ATTACK_SAMPLES+1)   //  40msec ( 16 of AP4 )
 
 class AirPressure {
 
 public:
   AirPressure( void ) : 
 //    _lastRawPressure(0.0),
-    _currentStandard(10000), _samePressureCounter(0),
-    _lastMidiValue(0), _afterStartCounter(0),
-    _movingAv(), _lastPressure(0) {}
+    _currentStandard(10000), _restoredStandard(0), _baseline(0), _noise(0), _quietCounter(0),
+    _lastExpValue(0), _lastSentExp(0), _attackVelocity(0x7f), _afterStartCounter(0),
+    _curve(), _calibrating(false), _peakDiff(0),
+    _tongueLevel(0), _dipCounter(0), _tongued(false),
+    _movingAv(), _lastPressure(0), _lastReadTime(0), _sensor() {}
 
-  int   getPressure( void );
+  int   init( void ){ return _sensor.init();}
+  int   getPressure( bool idle=false );
   bool  generateExpEvent( uint8_t* midiValue );
+  uint16_t  expression14( void ) const { return _lastSentExp;}   //  0 - 0x3fff
+  uint8_t   attackVelocity( void ) const { return _attackVelocity;}
+  bool  breathSensed( void ) const;
+  bool  tonguingEvent( void );
+  void  changeCurve( int step );
+  int   curveNumber( void ) const { return _curve.number();}
+#ifdef USE_BREATH_VIBRATO
+  const Vibrato&  vibrato( void ) const { return _vibrato;}
+#endif
+
+  //  for diagnostics
+  int   standardPressure( void ) const { return _currentStandard;}
+  void  restoreStandardPressure( int prs );
+  int   noiseLevel( void ) const { return static_cast<int>(_noise >> (BASE_FRAC_BITS-4));}  //  1/16 of pressure unit
+  const DeviceHealth& sensorHealth( void ) const { return _sensor.health();}
+  uint16_t  sensorOverrun( void ){ return _sensor.overrunCount();}
 
 private:
   void      analyseStandardPressure( int crntPrs );
-  uint8_t   interpolateMidiExp( uint8_t realExp );
+  uint8_t   detectAttackVelocity( void ) const;
+  void      detectTonguing( int rawPrs );
+  void      calibrateCurve( int diff );
+  uint16_t  interpolateMidiExp( uint16_t realExp );
 
 
-  static const uint8_t  ZERO_OFFSET;
-  static const int MIDI_EXP_ITP_STEP;
-  static const int STABLE_COUNT;
+  static const int PRS_PER_INDEX;
+  static const int EXP14_MIN_DIFF;
+  static const int EXP_ITP_SHIFT;
   static const int PWRON_DEAD_BAND_TIME;
-  static const int NOISE_WIDTH;
+  static const int RESTORED_DEAD_BAND_TIME;
+  static const int BASE_FRAC_BITS;
+  static const int BASE_SLOW_SHIFT;
+  static const int BASE_FAST_SHIFT;
+  static const int NOISE_AV_SHIFT;
+  static const int CALIB_MIN_PEAK;
+  static const int ATTACK_SAMPLES;
+  static const int32_t ATTACK_TIME_US;
+  static const int ATTACK_SLOPE_SHIFT;
+  static const int VELOCITY_MIN;
+  static const int TONGUE_DIP_MIN;
+  static const int TONGUE_MAX_SAMPLES;
+  static const int TONGUE_LEVEL_SHIFT;
 
-  static const int INPUT_INDEX_MAX = 130;
-  static const uint8_t pressureToMidiTable[INPUT_INDEX_MAX];
+  static const uint16_t EXP14_MAX = 0x3fff;
 
 //  float   _lastRawPressure;
   int     _currentStandard;
-  int     _newProposedPressure;
-  int     _samePressureCounter;
-  uint8_t _lastMidiValue;
+  int     _restoredStandard;
+  int32_t _baseline;      //  standard pressure (fixed point: BASE_FRAC_BITS)
+  int32_t _noise;         //  mean deviation when not blowing (fixed point: BASE_FRAC_BITS)
+  int     _quietCounter;
+  uint16_t  _lastExpValue;   //  14bit
+  uint16_t  _lastSentExp;    //  14bit
+  uint8_t   _attackVelocity;
   int     _afterStartCounter;
 
+  //  Breath Curve
+  BreathCurve _curve;
+  bool    _calibrating;
+  int     _peakDiff;
+
+  //  Tonguing
+  int     _tongueLevel;
+  uint8_t _dipCounter;
+  bool    _tongued;
+
   //  Moving Avarage for Air Pressure
   int     _movingAv[MOVING_AV_MAX];
   int     _lastPressure;
+  uint16_t  _lastReadTime;  //  usec, of a FIFO sensor or while idle
+
+  PressureDevice  _sensor;
+#ifdef USE_BREATH_VIBRATO
+  Vibrato         _vibrato;
+#endif
 };
 #endif
 
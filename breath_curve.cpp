@@ -0,0 +1,90 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  breath_curve.cpp
+ *    description: Breath Curve Functions
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#include "breath_curve.h"
+
+//  14bit expression at every (1<<SEG_BITS) raw sensor count
+const BreathCurve::CurveTable BreathCurve::logCurve PROGMEM =
+{
+      0,  4798,  6733,  7894,  8849,  9546, 10087, 10629, 11042, 11352,
+  11739, 12022, 12306, 12590, 12874, 13029, 13287, 13467, 13674, 13803,
+  14061, 14190, 14319, 14448, 14577, 14706, 14860, 14964, 15093, 15222,
+  15351, 15480, 15609, 15609, 15738, 15867, 15996, 15996, 16125, 16254,
+  16383
+};
+const BreathCurve::CurveTable BreathCurve::linearCurve PROGMEM =
+{
+      0,   410,   819,  1229,  1638,  2048,  2457,  2867,  3277,  3686,
+   4096,  4505,  4915,  5324,  5734,  6144,  6553,  6963,  7372,  7782,
+   8192,  8601,  9011,  9420,  9830, 10239, 10649, 11059, 11468, 11878,
+  12287, 12697, 13106, 13516, 13926, 14335, 14745, 15154, 15564, 15973,
+  16383
+};
+const BreathCurve::CurveTable BreathCurve::softCurve PROGMEM =   //  x^1.6
+{
+      0,    45,   136,   260,   412,   588,   787,  1008,  1248,  1506,
+   1783,  2076,  2387,  2713,  3054,  3411,  3782,  4167,  4566,  4979,
+   5404,  5843,  6295,  6759,  7235,  7723,  8223,  8735,  9259,  9793,
+  10339, 10896, 11464, 12043, 12632, 13231, 13841, 14462, 15092, 15733,
+  16383
+};
+
+/*----------------------------------------------------------------------------*/
+BreathCurve::BreathCurve( void ) :
+  _curveNumber(CURVE_LOG), _playerPeak(0), _crntCurve()
+{
+  for ( int i=0; i<=SEG_NUM; i++ ){
+    _crntCurve[i] = logCurve[i];
+  }
+}
+/*----------------------------------------------------------------------------*/
+//  the curve is copied to RAM here, so exp14() reads one table always
+void BreathCurve::select( int num )
+{
+  static const CurveTable* const curveTable[CURVE_MAX] = { &logCurve, &linearCurve, &softCurve, 0 };
+
+  if (( num < 0 ) || ( num >= CURVE_MAX )){ return;}
+  _curveNumber = num;
+  if ( num == CURVE_PLAYER ){
+    makePlayerCurve();
+    return;
+  }
+  const CurveTable& tbl = *curveTable[num];
+  for ( int i=0; i<=SEG_NUM; i++ ){
+    _crntCurve[i] = tbl[i];
+  }
+}
+/*----------------------------------------------------------------------------*/
+//
+//     Make Player's Curve
+//        peak : the strongest breath of the player (raw sensor count)
+//
+/*----------------------------------------------------------------------------*/
+void BreathCurve::calibrate( int peak )
+{
+  if ( peak <= 0 ){ return;}
+
+  _playerPeak = peak;
+  if ( _curveNumber == CURVE_PLAYER ){ makePlayerCurve();}
+}
+/*----------------------------------------------------------------------------*/
+//  log curve stretched to the player's peak, log curve itself if not calibrated
+void BreathCurve::makePlayerCurve( void )
+{
+  const int peak = ( _playerPeak > 0 )? _playerPeak:INPUT_SPAN;
+
+  for ( int i=0; i<=SEG_NUM; i++ ){
+    int32_t x = (static_cast<int32_t>(i) << SEG_BITS)*INPUT_SPAN/peak;
+    if ( x > INPUT_SPAN-1 ){ x = INPUT_SPAN-1;}
+    _crntCurve[i] = interpolate(logCurve, static_cast<uint16_t>(x));
+  }
+  _crntCurve[SEG_NUM] = logCurve[SEG_NUM];
+}
@@ -0,0 +1,71 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  breath_curve.h
+ *    description: Breath Curve Class
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#ifndef BREATH_CURVE_H
+#define BREATH_CURVE_H
+
+#include <Arduino.h>
+#include "flash_table.h"
+
+class BreathCurve {
+
+public:
+  enum {
+    CURVE_LOG,        //  same as the former pressureToMidiTable
+    CURVE_LINEAR,
+    CURVE_SOFT,
+    CURVE_PLAYER,     //  made by calibrate()
+    CURVE_MAX
+  };
+
+  static const int SEG_BITS = 5;
+  static const int SEG_NUM = 40;
+  static const int INPUT_SPAN = SEG_NUM << SEG_BITS;   //  raw sensor count
+
+  BreathCurve( void );
+
+  void      select( int num );
+  int       number( void ) const { return _curveNumber;}
+  uint16_t  exp14( uint16_t x ) const   //  x: 0 - INPUT_SPAN-1
+            { return interpolate(_crntCurve, x);}
+  void      calibrate( int peak );
+
+private:
+  typedef FlashTable<uint16_t,SEG_NUM+1> CurveTable;
+
+  //  Piecewise Linear Interpolation ( tbl: CurveTable in flash, or array in RAM )
+  //    no branch, constant time, 16bit multiplies only
+  //    slope*frac needs 20bit, so slope is split as hi*32 + lo, and the
+  //    result is the same as ( slope*frac ) >> SEG_BITS in 32bit
+  template <typename TBL>
+  static uint16_t interpolate( const TBL& tbl, uint16_t x )
+  {
+    const uint8_t seg = static_cast<uint8_t>(x >> SEG_BITS);
+    const uint8_t frac = static_cast<uint8_t>(x & ((1<<SEG_BITS)-1));
+    const uint16_t y0 = tbl[seg];
+    const int16_t slope = static_cast<int16_t>(tbl[seg+1] - y0);
+    const int16_t hi = slope >> SEG_BITS;     //  |hi| < 512
+    const uint8_t lo = static_cast<uint8_t>(slope & ((1<<SEG_BITS)-1));
+    return static_cast<uint16_t>(y0 + hi*frac + ((lo*frac) >> SEG_BITS));
+  }
+
+  static const CurveTable logCurve;
+  static const CurveTable linearCurve;
+  static const CurveTable softCurve;
+
+  void      makePlayerCurve( void );
+
+  int       _curveNumber;
+  int       _playerPeak;    //  0: not calibrated
+  uint16_t  _crntCurve[SEG_NUM+1];    //  copied when selected
+
+};
+#endif
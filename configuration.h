@@ -18,6 +18,42 @@
 #define   USE_SIX_TOUCH_SENS
 #define   MAX_LED       6
 
+//---------------------------------------------------------
+//    MIDI Output
+//---------------------------------------------------------
+#define   EXP_OUT_7BIT      0   //  CC#11 only
+#define   EXP_OUT_14BIT     1   //  CC#11(MSB) + CC#43(LSB)
+#define   EXP_OUTPUT        EXP_OUT_14BIT
+#define   USE_MIDI_RUNNING_STATUS
+
+//  Merge MIDI of another unit on RX into own output
+//    channel is shifted by PRM_MERGE_CH_SHIFT
+//#define   USE_MIDI_MERGE
+
+//---------------------------------------------------------
+//    Profiler
+//      dump by SysEx F0 7D 01 F7
+//---------------------------------------------------------
+//#define   USE_PROFILER
+//#define   PROFILER_GPIO_RED     PROF_BREATH   //  probe ID output to RED_LED
+//#define   PROFILER_GPIO_GREEN   PROF_I2C      //  probe ID output to GREEN_LED
+
+//  Breath vibrato depth -> CC#1, rate -> CC#76, growl -> CC#16
+#define   USE_BREATH_VIBRATO
+
+//---------------------------------------------------------
+//    Power Saving
+//      when idle, touch is read every 10msec, breath once a
+//      sample period, and CPU sleeps between interrupts
+//---------------------------------------------------------
+#define   USE_IDLE_SLEEP
+
+//---------------------------------------------------------
+//    Trace Capture
+//      sensor samples are sent as SysEx with MIDI output
+//---------------------------------------------------------
+//#define   USE_TRACE_CAPTURE
+
 //---------------------------------------------------------
 //    Firmware Mode
 //---------------------------------------------------------
@@ -40,4 +76,11 @@
 //#define		USE_ATTINY
 //#define		USE_PCA9544A
 
+//  number of CY8CMBR3110 ( 10 keys each )
+//    two chips (0x38,0x39) on each PCA9544A channel
+#define   MBR3110_CHIP_MAX    1
+
+//  number of PCA9685 ( 4 full color LEDs each, from 0x40 )
+#define   PCA9685_CHIP_MAX    1
+
 #endif
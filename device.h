@@ -0,0 +1,321 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  device.h
+ *    description: Device Interface ( resolved at compile time )
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#ifndef DEVICE_H
+#define DEVICE_H
+
+#include <Arduino.h>
+#include "configuration.h"
+#include "i2cdevice.h"
+#include "TouchMIDI_AVR_if.h"
+
+//  Each interface calls DEV's function by static_cast (CRTP), so there is
+//  no virtual table and every call is inlined to the driver function.
+//  A device class defines xxxDevice() functions.
+
+/*----------------------------------------------------------------------------*/
+//     Device Health
+//       offline after ERR_MAX errors in a row, the bus is recovered,
+//       then the device is re-initialized with backoff
+/*----------------------------------------------------------------------------*/
+//  id in the device report
+enum {
+  DEV_ID_PRESSURE,
+  DEV_ID_TOUCH,
+  DEV_ID_MOTION,    //  ADXL345
+  DEV_ID_DISPLAY,   //  ADA88
+  DEV_ID_LED,       //  PCA9685
+  DEV_ID_MAX
+};
+#define DEV_REPORT_SIZE   6     //  bytes of an entry
+class DeviceHealth {
+public:
+  DeviceHealth( void ) : _retryTime(0), _backoff(BACKOFF_MIN), _errCount(0), _errInRow(0), _online(true) {}
+
+  bool      online( void ) const { return _online;}
+  uint16_t  errorCount( void ) const { return _errCount;}
+  void      succeed( void ){ _errInRow = 0;}
+  void      fail( void )
+            {
+              if ( _errCount < 0xffff ){ _errCount++;}
+              if ( ++_errInRow < ERR_MAX ){ return;}
+              i2c_recoverBus();
+              goOffline();
+            }
+  void      goOffline( void ){ _online = false; wait(_backoff);}
+  bool      retryNow( void ) const { return static_cast<int16_t>(now() - _retryTime) >= 0;}
+  void      wait( uint16_t ms ){ _retryTime = now() + ms;}
+  void      retryFailed( void )
+            {
+              if ( _backoff < BACKOFF_MAX ){ _backoff <<= 1;}
+              wait(_backoff);
+            }
+  void      recovered( void ){ _online = true; _errInRow = 0; _backoff = BACKOFF_MIN;}
+
+  //  an entry of the device report ( SysEx 37 ): id online errors(2) overruns(2)
+  uint8_t*  put( uint8_t* buf, uint8_t id, uint16_t overrun=0 ) const
+            {
+              const uint16_t err = ( _errCount > 0x3fff )? 0x3fff:_errCount;
+              if ( overrun > 0x3fff ){ overrun = 0x3fff;}
+              *buf++ = id;
+              *buf++ = _online? 1:0;
+              *buf++ = static_cast<uint8_t>(err >> 7);
+              *buf++ = static_cast<uint8_t>(err & 0x7f);
+              *buf++ = static_cast<uint8_t>(overrun >> 7);
+              *buf++ = static_cast<uint8_t>(overrun & 0x7f);
+              return buf;
+            }
+
+private:
+  static uint16_t now( void ){ return static_cast<uint16_t>(millis());}
+
+  static const uint8_t  ERR_MAX = 3;
+  static const uint16_t BACKOFF_MIN = 100;    //  msec
+  static const uint16_t BACKOFF_MAX = 3200;
+
+  uint16_t  _retryTime;
+  uint16_t  _backoff;
+  uint16_t  _errCount;    //  since power on
+  uint8_t   _errInRow;
+  bool      _online;
+};
+
+/*----------------------------------------------------------------------------*/
+//     Pressure Sensor ( raw 14bit count )
+/*----------------------------------------------------------------------------*/
+template <class DEV>
+class PressureSensor {
+public:
+  static const uint8_t SAMPLE_MAX = 1;    //  by one readSamples(), DEV may hide it
+  static const uint16_t SAMPLE_PERIOD_US = 2500;  //  between samples, polled by loop()
+
+  int     init( void )
+          {
+            int err = dev().initDevice();
+            if ( err != 0 ){ _health.goOffline();}
+            return err;
+          }
+  int     read( void ){ return dev().readDevice();}
+  //  samples got by one transaction, returns the number
+  //    0 while the device is offline
+  uint8_t readSamples( int* buf, uint8_t max )
+          {
+            if ( _health.online() == false ){
+              if ( _health.retryNow() == true ){
+                if ( dev().initDevice() == 0 ){ _health.recovered();}
+                else { _health.retryFailed();}
+              }
+              return 0;
+            }
+            i2cErrCode = 0;
+            const uint8_t num = dev().readSamplesDevice(buf, max);
+            if ( i2cErrCode != 0 ){ _health.fail(); return 0;}
+            _health.succeed();
+            return num;
+          }
+  bool    online( void ) const { return _health.online();}
+  const DeviceHealth& health( void ) const { return _health;}
+  uint16_t  overrunCount( void ){ return dev().overrunDevice();}  //  FIFO, since power on
+
+protected:
+  //  default: one sample, no FIFO
+  int     initDevice( void ){ return 0;}
+  uint8_t readSamplesDevice( int* buf, uint8_t /*max*/ ){ buf[0] = dev().readDevice(); return 1;}
+  uint16_t  overrunDevice( void ){ return 0;}
+
+private:
+  DEV&    dev( void ){ return *static_cast<DEV*>(this);}
+
+  DeviceHealth  _health;
+};
+
+class Ap4Pressure : public PressureSensor<Ap4Pressure> {
+  friend class PressureSensor<Ap4Pressure>;
+  int     initDevice( void ){ i2cErrCode = 0; ap4_getAirPressure(); return i2cErrCode;}  //  answers or not
+  int     readDevice( void ){ return ap4_getAirPressure();}
+};
+
+class AnalogPressure : public PressureSensor<AnalogPressure> {
+  friend class PressureSensor<AnalogPressure>;
+  int     readDevice( void ){ return analogDataRead();}
+};
+
+//  LPS22HB/LPS25H: absolute pressure (4096/hPa) from FIFO
+//    the first sample is the atmosphere, converted to AP4 count
+//    ( offset 1638, 64/hPa )
+class LpsScale {
+public:
+  LpsScale( void ) : _ref(0), _last(LPS_OFFSET) {}
+  int     convert( long raw )
+          {
+            if ( _ref == 0 ){ _ref = raw;}
+            long cnt = ((raw - _ref) >> 6) + LPS_OFFSET;
+            if ( cnt < 0 ){ cnt = 0;}
+            else if ( cnt > 16383 ){ cnt = 16383;}
+            _last = static_cast<int>(cnt);
+            return _last;
+          }
+  int     last( void ) const { return _last;}
+private:
+  static const int LPS_OFFSET = 1638;
+  long    _ref;
+  int     _last;
+};
+
+class Lps22hbPressure : public PressureSensor<Lps22hbPressure> {
+public:
+  static const uint8_t SAMPLE_MAX = LPS_BURST_MAX;
+  static const uint16_t SAMPLE_PERIOD_US = 13333;  //  75Hz ODR
+private:
+  friend class PressureSensor<Lps22hbPressure>;
+  int     initDevice( void ){ return lps22hb_init();}
+  int     readDevice( void ){ int smpl; return readSamplesDevice(&smpl, 1)? smpl:_scale.last();}
+  uint8_t readSamplesDevice( int* buf, uint8_t max )
+          {
+            long raw[LPS_BURST_MAX];
+            int num = 0;
+            if ( max > LPS_BURST_MAX ){ max = LPS_BURST_MAX;}
+            lps22hb_readFifo(raw, max, &num);
+            for ( int i=0; i<num; i++ ){ buf[i] = _scale.convert(raw[i]);}
+            return static_cast<uint8_t>(num);
+          }
+  LpsScale  _scale;
+};
+
+class Lps25hPressure : public PressureSensor<Lps25hPressure> {
+public:
+  static const uint8_t SAMPLE_MAX = 4;
+  static const uint16_t SAMPLE_PERIOD_US = 40000;  //  25Hz ODR
+private:
+  friend class PressureSensor<Lps25hPressure>;
+  int     initDevice( void ){ return lps25h_init();}
+  int     readDevice( void ){ int smpl; return readSamplesDevice(&smpl, 1)? smpl:_scale.last();}
+  uint8_t readSamplesDevice( int* buf, uint8_t max )
+          {
+            long raw[SAMPLE_MAX];
+            int num = 0;
+            if ( max > SAMPLE_MAX ){ max = SAMPLE_MAX;}
+            lps25h_readFifo(raw, max, &num);
+            for ( int i=0; i<num; i++ ){ buf[i] = _scale.convert(raw[i]);}
+            return static_cast<uint8_t>(num);
+          }
+  uint16_t  overrunDevice( void ){ return lps25h_overrunCount();}
+  LpsScale  _scale;
+};
+
+/*----------------------------------------------------------------------------*/
+//     Touch Sensor ( key bits )
+/*----------------------------------------------------------------------------*/
+template <class DEV>
+class TouchSensor {
+public:
+  int     init( void )
+          {
+            int err = dev().initDevice();
+            if ( err != 0 ){ _health.goOffline();}
+            return err;
+          }
+  //  keys are not changed while the device is offline
+  int     scan( unsigned long* keys )
+          {
+            if ( _health.online() == false ){
+              if ( _health.retryNow() == true ){
+                int wait = 0;
+                if ( dev().reinitDevice(&wait) != 0 ){ _health.retryFailed();}
+                else if ( wait != 0 ){ _health.wait(static_cast<uint16_t>(wait));}
+                else { _health.recovered();}
+              }
+              return I2C_ERR_OFFLINE;
+            }
+            int err = dev().scanDevice(keys);
+            if ( err != 0 ){ _health.fail();}
+            else { _health.succeed();}
+            return err;
+          }
+  bool    online( void ) const { return _health.online();}
+  const DeviceHealth& health( void ) const { return _health;}
+
+protected:
+  //  default: blocking init at once
+  int     reinitDevice( int* wait ){ *wait = 0; return dev().initDevice();}
+
+private:
+  DEV&    dev( void ){ return *static_cast<DEV*>(this);}
+
+  DeviceHealth  _health;
+};
+
+class Mbr3110Touch : public TouchSensor<Mbr3110Touch> {
+  friend class TouchSensor<Mbr3110Touch>;
+  int     initDevice( void )
+          {
+            for ( int i=0; i<MBR3110_CHIP_MAX; i++ ){
+              int err = MBR3110_init(i);
+              if ( err != 0 ){ return err;}
+            }
+            return 0;
+          }
+  int     reinitDevice( int* wait ){ return MBR3110_reinitStep(wait);}   //  without delay
+  int     scanDevice( unsigned long* keys ){ return MBR3110_scanTouchSw(keys);}
+};
+
+class NoTouch : public TouchSensor<NoTouch> {
+  friend class TouchSensor<NoTouch>;
+  int     initDevice( void ){ return 0;}
+  int     scanDevice( unsigned long* keys ){ *keys = 0; return 0;}
+};
+
+/*----------------------------------------------------------------------------*/
+//     Display
+/*----------------------------------------------------------------------------*/
+template <class DEV>
+class Display {
+public:
+  void    init( void ){ if ( dev().initDevice() != 0 ){ _health.goOffline();}}
+  //  nothing is written while the device is offline
+  void    writeLetter( int letter ){ if ( ready() == true ){ result(dev().writeLetterDevice(letter));}}
+  void    writeNumber( int number ){ if ( ready() == true ){ result(dev().writeNumberDevice(number));}}
+  bool    online( void ) const { return _health.online();}
+  const DeviceHealth& health( void ) const { return _health;}
+
+private:
+  DEV&    dev( void ){ return *static_cast<DEV*>(this);}
+  bool    ready( void )
+          {
+            if ( _health.online() == true ){ return true;}
+            if ( _health.retryNow() == false ){ return false;}
+            if ( dev().initDevice() != 0 ){ _health.retryFailed(); return false;}
+            _health.recovered();
+            return true;
+          }
+  void    result( int err )
+          {
+            if ( err != 0 ){ _health.fail();}
+            else { _health.succeed();}
+          }
+
+  DeviceHealth  _health;
+};
+
+class Ada88Display : public Display<Ada88Display> {
+  friend class Display<Ada88Display>;
+  int     initDevice( void ){ i2cErrCode = 0; ada88_init(); return i2cErrCode;}
+  int     writeLetterDevice( int letter ){ i2cErrCode = 0; ada88_write(letter); return i2cErrCode;}
+  int     writeNumberDevice( int number ){ i2cErrCode = 0; ada88_writeNumber(number); return i2cErrCode;}  //  -1999 - 1999
+};
+
+class NoDisplay : public Display<NoDisplay> {
+  friend class Display<NoDisplay>;
+  int     initDevice( void ){ return 0;}
+  int     writeLetterDevice( int ){ return 0;}
+  int     writeNumberDevice( int ){ return 0;}
+};
+#endif
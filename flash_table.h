@@ -0,0 +1,51 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  flash_table.h
+ *    description: Constant Table in Flash
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#ifndef FLASH_TABLE_H
+#define FLASH_TABLE_H
+
+#include <Arduino.h>
+
+//  On AVR, const data is copied to SRAM at startup unless PROGMEM.
+//  A table defined as
+//    const FlashTable<uint8_t,64> tbl PROGMEM = { ... };
+//  stays in flash and tbl[i] reads it by pgm_read_*.
+//  Other platforms read it as usual memory.
+#ifdef __AVR__
+  #include <avr/pgmspace.h>
+
+template <typename T> inline T flashRead( const T* adrs )
+{
+  T value;
+  memcpy_P( &value, adrs, sizeof(T) );
+  return value;
+}
+template <> inline uint8_t flashRead( const uint8_t* adrs ){ return pgm_read_byte(adrs);}
+template <> inline int8_t flashRead( const int8_t* adrs ){ return static_cast<int8_t>(pgm_read_byte(adrs));}
+template <> inline uint16_t flashRead( const uint16_t* adrs ){ return pgm_read_word(adrs);}
+template <> inline int16_t flashRead( const int16_t* adrs ){ return static_cast<int16_t>(pgm_read_word(adrs));}
+#else
+  #ifndef PROGMEM
+    #define PROGMEM
+  #endif
+
+template <typename T> inline T flashRead( const T* adrs ){ return *adrs;}
+#endif
+
+//-------------------------------------------------------------------------
+template <typename T, int N>
+struct FlashTable {
+  T operator[]( int index ) const { return flashRead(&_data[index]);}
+  static int size( void ){ return N;}
+
+  T   _data[N];     //  public to be initialized as an aggregate
+};
+#endif
@@ -0,0 +1,97 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  harmonizer.cpp
+ *    description: Harmony Voices
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#include "harmonizer.h"
+#include "TouchMIDI_AVR_if.h"
+#include "note_tracker.h"
+
+extern NoteTracker nt;
+
+//  0 means no voice
+const FlashTable<int8_t,Harmonizer::VOICE_MAX> Harmonizer::intervalTable[MODE_MAX] PROGMEM =
+{
+  {   0,         0,         0   },  //  OFF
+  { -12,         0,         0   },  //  OCT_DOWN
+  {   7,         0,         0   },  //  FIFTH
+  { SCALE_3RD,   0,         0   },  //  THIRD
+  { SCALE_3RD,   SCALE_5TH, 0   },  //  TRIAD
+  { -12,         7,         12  }   //  POWER
+};
+
+//  in C major scale of fingering
+//                                    C  C# D  D# E  F  F# G  G# A  A# B
+const FlashTable<int8_t,12> Harmonizer::thirdAbove PROGMEM = { 4, 3, 3, 3, 3, 4, 3, 4, 3, 3, 3, 3 };
+const FlashTable<int8_t,12> Harmonizer::fifthAbove PROGMEM = { 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 6 };
+
+/*----------------------------------------------------------------------------*/
+Harmonizer::Harmonizer( void ) : _mode(MODE_OFF)
+{
+  for ( int i=0; i<VOICE_MAX; i++ ){ _voiceNote[i] = NO_NOTE;}
+}
+/*----------------------------------------------------------------------------*/
+void Harmonizer::changeMode( int step )
+{
+  noteOff();
+  _mode = static_cast<uint8_t>((_mode + step + MODE_MAX) % MODE_MAX);
+}
+/*----------------------------------------------------------------------------*/
+void Harmonizer::noteOn( uint8_t note, int offset, uint8_t vel )
+{
+  noteOff();
+
+  for ( int i=0; i<VOICE_MAX; i++ ){
+    int8_t itv = intervalTable[_mode][i];
+    if ( itv == 0 ){ continue;}
+    else if ( itv == SCALE_3RD ){ itv = thirdAbove[note%12];}
+    else if ( itv == SCALE_5TH ){ itv = fifthAbove[note%12];}
+
+    int voice = note + offset + itv;
+    if (( voice < 0 ) || ( voice > 127 )){ continue;}
+
+    _voiceNote[i] = static_cast<uint8_t>(voice);
+    nt.noteOn( 1+i, _voiceNote[i], vel, true );
+  }
+}
+/*----------------------------------------------------------------------------*/
+void Harmonizer::noteOff( void )
+{
+  //  release exactly the sounding notes even if transpose was changed
+  for ( int i=0; i<VOICE_MAX; i++ ){
+    if ( _voiceNote[i] == NO_NOTE ){ continue;}
+    nt.noteOff( 1+i, _voiceNote[i], true );
+    _voiceNote[i] = NO_NOTE;
+  }
+}
+/*----------------------------------------------------------------------------*/
+void Harmonizer::expression( uint8_t value )
+{
+  if ( _mode == MODE_OFF ){ return;}
+  for ( int i=0; i<VOICE_MAX; i++ ){
+    if ( intervalTable[_mode][i] == 0 ){ continue;}
+    setMidiBufferLowPriority( 0xb1+i, 0x0b, value );
+  }
+}
+/*----------------------------------------------------------------------------*/
+void Harmonizer::pitchBend( uint16_t value )
+{
+  if ( _mode == MODE_OFF ){ return;}
+  for ( int i=0; i<VOICE_MAX; i++ ){
+    if ( intervalTable[_mode][i] == 0 ){ continue;}
+    setMidiBufferLowPriority( 0xe1+i, value & 0x7f, (value>>7) & 0x7f );
+  }
+}
+/*----------------------------------------------------------------------------*/
+void Harmonizer::programChange( uint8_t number )
+{
+  for ( int i=0; i<VOICE_MAX; i++ ){
+    setMidiBufferLowPriority( 0xc1+i, number, 0xff );
+  }
+}
@@ -0,0 +1,57 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  harmonizer.h
+ *    description: Harmony Voices
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#ifndef HARMONIZER_H
+#define HARMONIZER_H
+
+#include <Arduino.h>
+#include "flash_table.h"
+
+//  Extra voices follow the lead note on MIDI ch.2-4.
+//  They are sent by low priority buffer, so never delay the lead note.
+class Harmonizer {
+
+public:
+  static const int VOICE_MAX = 3;
+
+  Harmonizer( void );
+
+  void    changeMode( int step );
+  int     mode( void ) const { return _mode;}
+  void    noteOn( uint8_t note, int offset, uint8_t vel );  //  note: fingered note, offset: transpose & octave
+  void    noteOff( void );
+  void    expression( uint8_t value );
+  void    pitchBend( uint16_t value );
+  void    programChange( uint8_t number );
+
+private:
+  enum {
+    MODE_OFF,
+    MODE_OCT_DOWN,
+    MODE_FIFTH,
+    MODE_THIRD,         //  diatonic
+    MODE_TRIAD,         //  diatonic
+    MODE_POWER,
+    MODE_MAX
+  };
+
+  static const int8_t   SCALE_3RD = 100;
+  static const int8_t   SCALE_5TH = 101;
+  static const FlashTable<int8_t,VOICE_MAX> intervalTable[MODE_MAX];
+  static const FlashTable<int8_t,12>  thirdAbove;
+  static const FlashTable<int8_t,12>  fifthAbove;
+
+  uint8_t   _mode;
+  uint8_t   _voiceNote[VOICE_MAX];    //  sounding note, NO_NOTE means off
+
+  static const uint8_t  NO_NOTE = 0xff;
+};
+#endif
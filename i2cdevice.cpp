@@ -14,12 +14,20 @@
 #include	"i2cdevice.h"
 
 #include  "TouchMIDI_AVR_if.h"
+#include  "profiler.h"
+#include  "flash_table.h"
 
 
 //---------------------------------------------------------
 //    Variables
 //---------------------------------------------------------
-int   i2cErrCode;
+int   i2cErrCode;     //  last error of any transfer, cleared by caller
+#ifdef USE_PCA9544A
+static int pca9544CrntBus = -1;   //  unknown
+#endif
+
+#define   I2C_TIMEOUT_US      3000
+#define   I2C_RECOVER_CLOCKS  9
 
 //---------------------------------------------------------
 //		Initialize I2C Device
@@ -28,6 +36,46 @@ void wireBegin( void )
 {
 	Wire.begin();
   Wire.setClock(400000);
+#if defined(WIRE_HAS_TIMEOUT)
+  //  a stuck bus returns error instead of hanging
+  Wire.setWireTimeout(I2C_TIMEOUT_US, true);
+#endif
+}
+//---------------------------------------------------------
+//    Recover I2C Bus
+//      a slave stopped in a read holds SDA low,
+//      clock it out ( 9 clocks at most ) and send STOP
+//---------------------------------------------------------
+int i2c_recoverBus( void )
+{
+  Wire.end();
+  pinMode(SDA, INPUT_PULLUP);
+  pinMode(SCL, INPUT_PULLUP);
+
+  //  open drain: drive low or release
+  for ( int i=0; (i<I2C_RECOVER_CLOCKS) && (digitalRead(SDA) == LOW); i++ ){
+    digitalWrite(SCL, LOW); pinMode(SCL, OUTPUT);
+    delayMicroseconds(5);
+    pinMode(SCL, INPUT_PULLUP);
+    delayMicroseconds(5);
+  }
+  digitalWrite(SDA, LOW); pinMode(SDA, OUTPUT);
+  delayMicroseconds(5);
+  pinMode(SDA, INPUT_PULLUP);   //  STOP
+  delayMicroseconds(5);
+
+  int err = (( digitalRead(SDA) == LOW ) || ( digitalRead(SCL) == LOW ))? 4:0;
+  wireBegin();
+#ifdef USE_PCA9544A
+  pca9544CrntBus = -1;
+#endif
+  return err;
+}
+//---------------------------------------------------------
+static int i2cResult( int err )
+{
+  if ( err != 0 ){ i2cErrCode = err;}
+  return err;
 }
 //---------------------------------------------------------
 //		Write I2C Device
@@ -37,12 +85,16 @@ void wireBegin( void )
 //      2:received NACK on transmit of address
 //      3:received NACK on transmit of data
 //      4:other error
+//      5:timeout
 //---------------------------------------------------------
 int write_i2cDevice( unsigned char adrs, unsigned char* buf, int count )
 {
+  PROF_BEGIN(PROF_I2C);
 	Wire.beginTransmission(adrs);
   Wire.write(buf,count);
-	return Wire.endTransmission();
+	int err = Wire.endTransmission();
+  PROF_END(PROF_I2C);
+  return i2cResult(err);
 }
 //---------------------------------------------------------
 //		Read 1byte I2C Device
@@ -51,18 +103,21 @@ int read1byte_i2cDevice( unsigned char adrs, unsigned char* wrBuf, unsigned char
 {
 	unsigned char err;
 
+  PROF_BEGIN(PROF_I2C);
 	Wire.beginTransmission(adrs);
   Wire.write(wrBuf,wrCount);
 	err = Wire.endTransmission(false);
-	if ( err != 0 ){ return err; }
+	if ( err != 0 ){ PROF_END(PROF_I2C); return i2cResult(err); }
 
-	err = Wire.requestFrom(adrs,(uint8_t)1,(uint8_t)0);
+	const uint8_t got = Wire.requestFrom(adrs,(uint8_t)1,(uint8_t)0);
 	while(Wire.available()) {
 		*rdBuf = Wire.read();
 	}
 
 	err = Wire.endTransmission(true);
-	return err;
+	if (( err == 0 ) && ( got != 1 )){ err = 4; }
+  PROF_END(PROF_I2C);
+	return i2cResult(err);
 }
 //---------------------------------------------------------
 //		Read N byte I2C Device
@@ -78,21 +133,22 @@ int read_nbyte_i2cDevice( unsigned char adrs, unsigned char* wrBuf, unsigned cha
 {
 	unsigned char err;
 
+  PROF_BEGIN(PROF_I2C);
 	Wire.beginTransmission(adrs);
   Wire.write(wrBuf,wrCount);
 	err = Wire.endTransmission(false);
-	if ( err != 0 ){ return err; }
+	if ( err != 0 ){ PROF_END(PROF_I2C); return i2cResult(err); }
 
-	err = Wire.requestFrom(adrs,static_cast<uint8_t>(rdCount),(uint8_t)0);
-	int rdAv = 0;
-	while( rdAv = Wire.available() ) {
-		*(rdBuf+rdCount-rdAv) = Wire.read();
+	//	fewer bytes than requested is an error, not shifted data
+	const int got = Wire.requestFrom(adrs,static_cast<uint8_t>(rdCount),(uint8_t)0);
+	for ( int i=0; (i<got) && (Wire.available()>0); i++ ) {
+		rdBuf[i] = Wire.read();
 	}
 
 	err = Wire.endTransmission(true);
-	return err;
-
-	return 0;
+	if (( err == 0 ) && ( got != rdCount )){ err = 4; }
+  PROF_END(PROF_I2C);
+	return i2cResult(err);
 }
 //---------------------------------------------------------
 //    Read Only N byte I2C Device
@@ -107,15 +163,16 @@ int read_only_nbyte_i2cDevice( unsigned char adrs, unsigned char* rdBuf, int rdC
 {
   unsigned char err;
 
-  err = Wire.requestFrom(adrs,static_cast<uint8_t>(rdCount),static_cast<uint8_t>(false));
-  int rdAv = Wire.available();
-  while( rdAv ) {
-    *(rdBuf+rdCount-rdAv) = Wire.read();
-    rdAv--;
+  PROF_BEGIN(PROF_I2C);
+  const int got = Wire.requestFrom(adrs,static_cast<uint8_t>(rdCount),static_cast<uint8_t>(false));
+  for ( int i=0; (i<got) && (Wire.available()>0); i++ ) {
+    rdBuf[i] = Wire.read();
   }
 
   err = Wire.endTransmission(true);
-  return err;
+  if (( err == 0 ) && ( got != rdCount )){ err = 4; }
+  PROF_END(PROF_I2C);
+  return i2cResult(err);
 }
 
 #ifdef USE_CY8CMBR3110
@@ -124,6 +181,17 @@ int read_only_nbyte_i2cDevice( unsigned char adrs, unsigned char* rdBuf, int rdC
 //-------------------------------------------------------------------------
 #define		CONFIG_DATA_OFFSET	  0
 #define		CONFIG_DATA_SZ			  128
+#define		MBR3110_KEY_NUM			  10
+#define		MBR3110_KEY_MASK		  0x03ffUL
+#define		MBR3110_BOOT_TIME		  900		//	msec
+#define		MBR3110_SCAN_RETRY		1
+
+#if ( MBR3110_CHIP_MAX*MBR3110_KEY_NUM > 32 )
+  #error "too many CY8CMBR3110 for 32bit key state"
+#endif
+#if !defined(USE_PCA9544A) && ( MBR3110_CHIP_MAX > 2 )
+  #error "more than two CY8CMBR3110 need PCA9544A, addresses alias"
+#endif
 
 #define		SENSOR_EN		          0x00	//	Register Address
 #define		SENSITIVITY0			    0x08	//	Register Address
@@ -159,10 +227,12 @@ static const unsigned char CAP_SENSE_ADDRESS_2 = 0x39;
 //      Write CY8CMBR3110 Config Data
 //
 /*----------------------------------------------------------------------------*/
+typedef FlashTable<unsigned char,CONFIG_DATA_SZ> MBR3110Config;
+
 #if 1 // wide range small resolution
 /* Project: C:\Users\hasebems\Documents\Cypress Projects\Design0602\Design0602.cprj
  * Generated: 2019/06/02 6:52:53 +09:00 */
-static const unsigned char tCY8CMBR3110_ConfigData[CONFIG_DATA_SZ] = {
+static const MBR3110Config tCY8CMBR3110_ConfigData PROGMEM = {
     0xFFu, 0x03u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u,
     0xFFu, 0xFFu, 0x0Fu, 0x00u, 0x80u, 0x80u, 0x80u, 0x80u, //  adrs 08-0Ah: 11: 50count / 0.4pF
     0x80u, 0x80u, 0x80u, 0x80u, 0x80u, 0x80u, 0x00u, 0x00u,
@@ -182,7 +252,7 @@ static const unsigned char tCY8CMBR3110_ConfigData[CONFIG_DATA_SZ] = {
 };
 /* Project: C:\Users\hasebems\Documents\Cypress Projects\Design0602\Design0602-2.cprj
  * Generated: 2019/06/02 7:07:15 +09:00 */
-static const unsigned char tCY8CMBR3110_2_ConfigData[CONFIG_DATA_SZ] = {
+static const MBR3110Config tCY8CMBR3110_2_ConfigData PROGMEM = {
     0xFFu, 0x03u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u,
     0xFFu, 0xFFu, 0x0Fu, 0x00u, 0x80u, 0x80u, 0x80u, 0x80u, //  adrs 08-0Ah: 11: 50count / 0.4pF
     0x80u, 0x80u, 0x80u, 0x80u, 0x80u, 0x80u, 0x00u, 0x00u,
@@ -202,7 +272,7 @@ static const unsigned char tCY8CMBR3110_2_ConfigData[CONFIG_DATA_SZ] = {
 };
 #else // small range fine resolution
 /* Generated: 2019/03/09 14:04:18 +09:00 */
-static const unsigned char tCY8CMBR3110_ConfigData[CONFIG_DATA_SZ] =
+static const MBR3110Config tCY8CMBR3110_ConfigData PROGMEM =
 {
     0xFFu, 0x03u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u,
     0x00u, 0x00u, 0x00u, 0x00u, 0x80u, 0x80u, 0x80u, 0x80u, //  adrs 08-0Ah: 00: 50count / 0.1pF
@@ -222,7 +292,7 @@ static const unsigned char tCY8CMBR3110_ConfigData[CONFIG_DATA_SZ] =
     0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x81u, 0xA6u
 };
 /* Generated: 2019/03/09 14:11:51 +09:00 */
-static const unsigned char tCY8CMBR3110_2_ConfigData[CONFIG_DATA_SZ] =
+static const MBR3110Config tCY8CMBR3110_2_ConfigData PROGMEM =
 {
     0xFFu, 0x03u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u,
     0x00u, 0x00u, 0x00u, 0x00u, 0x80u, 0x80u, 0x80u, 0x80u, //  adrs 08-0Ah: 00: 50count / 0.1pF
@@ -243,10 +313,10 @@ static const unsigned char tCY8CMBR3110_2_ConfigData[CONFIG_DATA_SZ] =
 };
 #endif
 //-------------------------------------------------------------------------
-static const unsigned char* tConfigPtr[2] =
+static const MBR3110Config* const tConfigPtr[2] =
 {
-  tCY8CMBR3110_ConfigData,
-  tCY8CMBR3110_2_ConfigData
+  &tCY8CMBR3110_ConfigData,
+  &tCY8CMBR3110_2_ConfigData
 };
 //-------------------------------------------------------------------------
 static const unsigned char tI2cAdrs[2] =
@@ -255,24 +325,38 @@ static const unsigned char tI2cAdrs[2] =
   CAP_SENSE_ADDRESS_2
 };
 //-------------------------------------------------------------------------
+//  chip number -> PCA9544A channel: number/2, address & config: number%2
+static int MBR3110_selectChip( int number )
+{
+#ifdef USE_PCA9544A
+  return pca9544_changeI2cBus( number/2 );
+#else
+  (void)number;
+  return 0;
+#endif
+}
+//-------------------------------------------------------------------------
 int MBR3110_init( int number )
 {
  	unsigned char i2cdata[2];
 	unsigned char selfCheckResult;
 
-  const unsigned char* configData = tConfigPtr[number];
-  unsigned char i2cAdrs = tI2cAdrs[number];
+  const MBR3110Config& configData = *tConfigPtr[number%2];
+  unsigned char i2cAdrs = tI2cAdrs[number%2];
+
+  int err = MBR3110_selectChip(number);
+  if ( err != 0 ){ return err; }
 
   delay(15);
 	i2cdata[0] = CTRL_CMD;
   i2cdata[1] = POWER_ON_AND_FINISHED;
 	write_i2cDevice(i2cAdrs,i2cdata,2);
-  delay(900);
+  delay(MBR3110_BOOT_TIME);
 
   unsigned char checksum1, checksum2;
   checksum1 = configData[126];
   checksum2 = configData[127];
-  int err = MBR3110_checkWriteConfig(checksum1,checksum2,i2cAdrs);
+  err = MBR3110_checkWriteConfig(checksum1,checksum2,i2cAdrs);
   if ( err != 0 ){
     return err;
   }
@@ -288,19 +372,60 @@ int MBR3110_init( int number )
   return err;
 }
 //-------------------------------------------------------------------------
+//  Same as MBR3110_init() for all chips, but in small steps
+//    no delay and no retry, call again after *wait [msec]
+//    finished when *wait is 0
+//-------------------------------------------------------------------------
+int MBR3110_reinitStep( int* wait )
+{
+  static int number = 0;
+  static bool poweredOn = false;
+  unsigned char i2cAdrs = tI2cAdrs[number%2];
+  int err;
+
+  *wait = 0;
+  err = MBR3110_selectChip(number);
+  if (( err == 0 ) && ( poweredOn == false )){
+    unsigned char i2cdata[2] = { CTRL_CMD, POWER_ON_AND_FINISHED };
+    err = write_i2cDevice(i2cAdrs,i2cdata,2);
+    if ( err == 0 ){
+      poweredOn = true;
+      *wait = MBR3110_BOOT_TIME;
+      return 0;
+    }
+  }
+  else if ( err == 0 ){
+    const MBR3110Config& configData = *tConfigPtr[number%2];
+    unsigned char selfCheckResult = 0;
+    poweredOn = false;
+    err = MBR3110_checkWriteConfig(configData[126],configData[127],i2cAdrs,0);
+    if ( err == 0 ){ err = MBR3110_selfTest(&selfCheckResult,number,0); }
+    if (( err == 0 ) && ( selfCheckResult & 0x80 )){ err = selfCheckResult & 0x1f; }
+  }
+
+  if (( err != 0 ) || ( ++number >= MBR3110_CHIP_MAX )){
+    //  start from chip 0 next time
+    number = 0;
+    poweredOn = false;
+  }
+  else { *wait = 1; }   //  next chip
+  return err;
+}
+//-------------------------------------------------------------------------
 int MBR3110_setup( int number )
 {
   unsigned char i2cdata[2];
   unsigned char selfCheckResult;
   unsigned char i2cAdrs = 0;
 
+  MBR3110_selectChip(number);
   while(1){
 #if ( FIRMMODE == WRITE_CNFG_FIRST_TIME_TO_MBR3110 )
     //  for factory preset device
     i2cAdrs = CAP_SENSE_ADDRESS_ORG;
 #else
     //  for rewriting config to current device
-    i2cAdrs = tI2cAdrs[number];
+    i2cAdrs = tI2cAdrs[number%2];
 #endif
 
     delay(15);
@@ -310,14 +435,14 @@ int MBR3110_setup( int number )
     delay(900);
     int cnfgerr = MBR3110_writeConfig(number,i2cAdrs);
     
-    i2cAdrs = tI2cAdrs[number];
+    i2cAdrs = tI2cAdrs[number%2];
     delay(15);
     i2cdata[0] = CTRL_CMD;
     i2cdata[1] = POWER_ON_AND_FINISHED;
     write_i2cDevice(i2cAdrs,i2cdata,2);
     delay(900);
     
-    const unsigned char* configData = tConfigPtr[number];
+    const MBR3110Config& configData = *tConfigPtr[number%2];
     unsigned char checksum1, checksum2;
     checksum1 = configData[126];
     checksum2 = configData[127];      
@@ -355,16 +480,17 @@ int MBR3110_setup( int number )
 //    }
 //}
 //-------------------------------------------------------------------------
-int MBR3110_readData( unsigned char cmd, unsigned char* data, int length, unsigned char i2cAdrs )
+//	retry : times of 1msec retry, 0 for one access only
+int MBR3110_readData( unsigned char cmd, unsigned char* data, int length, unsigned char i2cAdrs, int retry )
 {
 	int err;
-	volatile int cnt = 0;
+	int cnt = 0;
 	unsigned char wrtBuf = cmd;
 
 	while(1) {
 		err = read_nbyte_i2cDevice(i2cAdrs,&wrtBuf,data,1,length);
 		if ( err == 0 ) break;
-		if ( ++cnt > 500 ){	//	if more than 500msec, give up and throw err
+		if ( ++cnt > retry ){	//	give up and throw err
 			return err;
 		}
 		delay(1);
@@ -372,11 +498,11 @@ int MBR3110_readData( unsigned char cmd, unsigned char* data, int length, unsign
 	return 0;
 }
 //-------------------------------------------------------------------------
-int MBR3110_selfTest( unsigned char* result, int number )
+int MBR3110_selfTest( unsigned char* result, int number, int retry )
 {
 	int err;
 
-	err = MBR3110_readData(TOTAL_WORKING_SNS,result,1,tI2cAdrs[number]);
+	err = MBR3110_readData(TOTAL_WORKING_SNS,result,1,tI2cAdrs[number%2],retry);
 	if ( err ){ return err; }
 
 	return 0;
@@ -388,8 +514,9 @@ void MBR3110_changeSensitivity( unsigned char data, int number )		//	data : 0-3
 	unsigned char regData2 = data & 0x03;
 	regData2 |= (regData2 << 2);
 	unsigned char regData4 = regData2 | (regData2<<4);
-  unsigned char i2cAdrs = tI2cAdrs[number];  
+  unsigned char i2cAdrs = tI2cAdrs[number%2];  
 
+  if ( MBR3110_selectChip(number) != 0 ){ return;}
 	i2cdata[0] = SENSITIVITY0;
 	i2cdata[1] = regData4;
 	if ( write_i2cDevice(i2cAdrs,i2cdata,2) ){
@@ -409,18 +536,46 @@ int MBR3110_readTouchSw( unsigned char* touchSw, int number )
 {
   int err;
 
-  err = MBR3110_readData(BUTTON_STAT,touchSw,2,tI2cAdrs[number]);
+  err = MBR3110_selectChip(number);
+  if ( err ){ return err; }
+
+  //  the chip NACKs the first access while waking from sleep,
+  //  so one retry ( 1msec at most ), then the caller decides
+  err = MBR3110_readData(BUTTON_STAT,touchSw,2,tI2cAdrs[number%2],MBR3110_SCAN_RETRY);
   if ( err ){ return err; }
 
   return 0;
 }
 //-------------------------------------------------------------------------
-int MBR3110_checkWriteConfig( unsigned char checksumL, unsigned char checksumH, unsigned char crntI2cAdrs )
+//  Read all chips in one frame, 10 keys each
+//    keys : chip0 bit0-9, chip1 bit10-19, ...
+//-------------------------------------------------------------------------
+int MBR3110_scanTouchSw( unsigned long* keys )
+{
+  static int scanTop = 0;   //  start from current mux channel not to switch back
+  unsigned long sw = 0;
+  int number = scanTop;
+
+  for ( int i=0; i<MBR3110_CHIP_MAX; i++ ){
+    unsigned char buf[2];
+    number = (scanTop + i) % MBR3110_CHIP_MAX;
+    int err = MBR3110_readTouchSw(buf, number);
+    if ( err ){ return err; }
+    unsigned long chipSw = (static_cast<unsigned long>(buf[1])<<8) | buf[0];
+    sw |= (chipSw & MBR3110_KEY_MASK) << (MBR3110_KEY_NUM*number);
+  }
+  scanTop = (number/2)*2;
+  *keys = sw;
+
+  return 0;
+}
+//-------------------------------------------------------------------------
+int MBR3110_checkWriteConfig( unsigned char checksumL, unsigned char checksumH, unsigned char crntI2cAdrs, int retry )
 {
 	unsigned char data[2];
 	int err;
 
-	err = MBR3110_readData(CONFIG_CRC,data,2,crntI2cAdrs);
+	err = MBR3110_readData(CONFIG_CRC,data,2,crntI2cAdrs,retry);
 	if ( err ){ return err; }
 
 	//	err=0 means it's present config
@@ -433,7 +588,7 @@ int MBR3110_writeConfig( int number, unsigned char crntI2cAdrs )
 {
 	unsigned char	data[CONFIG_DATA_SZ+1];
 	int				err;
-  const unsigned char* configData = tConfigPtr[number];
+  const MBR3110Config& configData = *tConfigPtr[number%2];
 
 	//*** Step 1 ***
 	//	Check Power On
@@ -532,7 +687,7 @@ void ada88_write( int letter )
 {
 	int	i;
 	unsigned char i2cBufx[17];
-	static const unsigned char letters[21][8] = {
+	static const FlashTable<unsigned char,8> letters[21] PROGMEM = {
 		{0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00},	//	0:nothing
 		{0x02,0x05,0x88,0x88,0x8f,0x88,0x88,0x88},	//	1:A
 		{0x87,0x88,0x88,0x87,0x88,0x88,0x88,0x87},	//	2:B
@@ -572,7 +727,7 @@ void ada88_writeNumber( int num )	//	num 1999 .. -1999
 	int i;
 	unsigned char i2cBufx[17];
 	unsigned char ledPtn[8] = {0};
-	static const unsigned char numletter[10][5] = {
+	static const FlashTable<unsigned char,5> numletter[10] PROGMEM = {
 		{ 0x07, 0x05, 0x05, 0x05, 0x07 },
 		{ 0x04, 0x04, 0x04, 0x04, 0x04 },
 		{ 0x07, 0x04, 0x07, 0x01, 0x07 },
@@ -584,7 +739,7 @@ void ada88_writeNumber( int num )	//	num 1999 .. -1999
 		{ 0x07, 0x05, 0x07, 0x05, 0x07 },
 		{ 0x07, 0x05, 0x07, 0x04, 0x07 }
 	};
-	static const unsigned char graph[10][2] = {
+	static const FlashTable<unsigned char,2> graph[10] PROGMEM = {
 		{ 0x00, 0x00 },
 		{ 0x00, 0x40 },
 		{ 0x40, 0x60 },
@@ -640,13 +795,142 @@ void ada88_writeNumber( int num )	//	num 1999 .. -1999
 #define   AP4_I2C_ADRS 0x28
 //-------------------------------------------------------------------------
 //      AP4
+//        return raw 14bit value
 //-------------------------------------------------------------------------
 int ap4_getAirPressure( void )
 {
   int   err = 0;
   unsigned char buf[2];
   err = read_only_nbyte_i2cDevice( AP4_I2C_ADRS, buf, 2);
-  return (static_cast<int>(buf[0]&0x3f)*256+buf[1])/10;
+  return (static_cast<int>(buf[0]&0x3f)<<8) | buf[1];
+}
+#endif
+
+
+#ifdef USE_LPS22HB
+//---------------------------------------------------------
+//    << LPS22HB >>
+//---------------------------------------------------------
+#define   LPS22HB_I2C_ADRS      0x5c
+#define   LPS22HB_WHO_AM_I      0x0f
+#define   LPS22HB_CTRL_REG1     0x10
+#define   LPS22HB_CTRL_REG2     0x11
+#define   LPS22HB_FIFO_CTRL     0x14
+#define   LPS22HB_FIFO_STATUS   0x26
+#define   LPS22HB_PRESS_OUT_XL  0x28    //  XL,L,H,TEMP_L,TEMP_H, then rolls back
+#define   LPS22HB_ID            0xb1
+#define   LPS22HB_SAMPLE_SZ     5
+//-------------------------------------------------------------------------
+int lps22hb_init( void )
+{
+  unsigned char reg = LPS22HB_WHO_AM_I;
+  unsigned char i2cBuf[2];
+  int err = read_nbyte_i2cDevice( LPS22HB_I2C_ADRS, &reg, i2cBuf, 1, 1 );
+  if ( err ){ return err; }
+  if ( i2cBuf[0] != LPS22HB_ID ){ return -1; }
+
+  i2cBuf[0] = LPS22HB_CTRL_REG2; i2cBuf[1] = 0x50;    //  FIFO_EN, IF_ADD_INC
+  err = write_i2cDevice( LPS22HB_I2C_ADRS, i2cBuf, 2 );
+  if ( err ){ return err; }
+  i2cBuf[0] = LPS22HB_FIFO_CTRL; i2cBuf[1] = 0x40;    //  Stream mode
+  err = write_i2cDevice( LPS22HB_I2C_ADRS, i2cBuf, 2 );
+  if ( err ){ return err; }
+  i2cBuf[0] = LPS22HB_CTRL_REG1; i2cBuf[1] = 0x52;    //  75Hz (top ODR), BDU
+  return write_i2cDevice( LPS22HB_I2C_ADRS, i2cBuf, 2 );
+}
+//-------------------------------------------------------------------------
+//      Drain FIFO by one burst
+//        prs : raw 24bit (4096/hPa), num : number of samples got
+//-------------------------------------------------------------------------
+int lps22hb_readFifo( long* prs, int max, int* num )
+{
+  unsigned char buf[LPS22HB_SAMPLE_SZ*LPS_BURST_MAX];
+  unsigned char reg = LPS22HB_FIFO_STATUS;
+  *num = 0;
+
+  int err = read_nbyte_i2cDevice( LPS22HB_I2C_ADRS, &reg, buf, 1, 1 );
+  if ( err ){ return err; }
+
+  int count = buf[0] & 0x3f;    //  FSS: unread samples
+  if ( count > max ){ count = max; }
+  if ( count > LPS_BURST_MAX ){ count = LPS_BURST_MAX; }
+  if ( count == 0 ){ return 0; }
+
+  reg = LPS22HB_PRESS_OUT_XL;
+  err = read_nbyte_i2cDevice( LPS22HB_I2C_ADRS, &reg, buf, 1, count*LPS22HB_SAMPLE_SZ );
+  if ( err ){ return err; }
+
+  for ( int i=0; i<count; i++ ){
+    const unsigned char* smpl = &buf[i*LPS22HB_SAMPLE_SZ];
+    prs[i] = static_cast<long>(smpl[0]) | (static_cast<long>(smpl[1])<<8) | (static_cast<long>(smpl[2])<<16);
+  }
+  *num = count;
+  return 0;
+}
+#endif
+
+
+#ifdef USE_LPS25H
+//---------------------------------------------------------
+//    << LPS25H >>
+//---------------------------------------------------------
+#define   LPS25H_I2C_ADRS       0x5c
+#define   LPS25H_WHO_AM_I       0x0f
+#define   LPS25H_CTRL_REG1      0x20
+#define   LPS25H_CTRL_REG2      0x21
+#define   LPS25H_FIFO_CTRL      0x2e
+#define   LPS25H_FIFO_STATUS    0x2f    //  OVRN(0x40), FSS(0x1f)
+#define   LPS25H_PRESS_OUT_XL   0x28
+#define   LPS25H_AUTO_INC       0x80    //  MSB of sub address
+#define   LPS25H_ID             0xbd
+//-------------------------------------------------------------------------
+int lps25h_init( void )
+{
+  unsigned char reg = LPS25H_WHO_AM_I;
+  unsigned char i2cBuf[2];
+  int err = read_nbyte_i2cDevice( LPS25H_I2C_ADRS, &reg, i2cBuf, 1, 1 );
+  if ( err ){ return err; }
+  if ( i2cBuf[0] != LPS25H_ID ){ return -1; }
+
+  i2cBuf[0] = LPS25H_CTRL_REG1; i2cBuf[1] = 0xc4;     //  Power On, 25Hz (top ODR), BDU
+  err = write_i2cDevice( LPS25H_I2C_ADRS, i2cBuf, 2 );
+  if ( err ){ return err; }
+  i2cBuf[0] = LPS25H_CTRL_REG2; i2cBuf[1] = 0x40;     //  FIFO_EN
+  err = write_i2cDevice( LPS25H_I2C_ADRS, i2cBuf, 2 );
+  if ( err ){ return err; }
+  i2cBuf[0] = LPS25H_FIFO_CTRL; i2cBuf[1] = 0x40;     //  Stream mode
+  return write_i2cDevice( LPS25H_I2C_ADRS, i2cBuf, 2 );
+}
+//-------------------------------------------------------------------------
+//      Drain FIFO
+//        address doesn't roll back, so one read for each sample
+//        prs : raw 24bit (4096/hPa), num : number of samples got
+//-------------------------------------------------------------------------
+static uint16_t lps25hOverrun = 0;
+uint16_t lps25h_overrunCount( void ){ return lps25hOverrun; }
+//-------------------------------------------------------------------------
+int lps25h_readFifo( long* prs, int max, int* num )
+{
+  unsigned char buf[3];
+  unsigned char reg = LPS25H_FIFO_STATUS;
+  *num = 0;
+
+  int err = read_nbyte_i2cDevice( LPS25H_I2C_ADRS, &reg, buf, 1, 1 );
+  if ( err ){ return err; }
+
+  //  overrun: the oldest samples are lost already
+  if (( buf[0] & 0x40 ) && ( lps25hOverrun < 0xffff )){ lps25hOverrun++; }
+  int count = buf[0] & 0x1f;
+  if ( count > max ){ count = max; }
+
+  for ( int i=0; i<count; i++ ){
+    reg = LPS25H_PRESS_OUT_XL | LPS25H_AUTO_INC;
+    err = read_nbyte_i2cDevice( LPS25H_I2C_ADRS, &reg, buf, 1, 3 );
+    if ( err ){ return err; }
+    prs[i] = static_cast<long>(buf[0]) | (static_cast<long>(buf[1])<<8) | (static_cast<long>(buf[2])<<16);
+    *num = i+1;
+  }
+  return 0;
 }
 #endif
 
@@ -749,15 +1033,18 @@ void aqm1602xa_setStringUpper( int locate, char* str, int strNum )
 #define	ACCEL_SNCR_RATE				0x2c
 #define ACCEL_SNCR_PWR_CTRL			0x2d
 #define ACCEL_SNCR_DATA_FORMAT		0x31
+#define ACCEL_SNCR_DATAX0			0x32	//	X0,X1,Y0,Y1,Z0,Z1
 //-------------------------------------------------------------------------
 void adxl345_init( unsigned char chipnum )
 {
 	unsigned char i2cadrs = ADXL345_I2C_ADRS;
 	if ( chipnum == 1 ){ i2cadrs = ADXL345_I2C_ADRS2; }
 
-	uint8	i2cBuf[2];
+	unsigned char	i2cBuf[2];
 
 	//	Start Access
+	i2cBuf[0] = ACCEL_SNCR_RATE; i2cBuf[1] = 0x0a;
+	write_i2cDevice(i2cadrs,i2cBuf,2);			//	100Hz (10msec)
 	i2cBuf[0] = ACCEL_SNCR_PWR_CTRL; i2cBuf[1] = 0x08;
 	write_i2cDevice(i2cadrs,i2cBuf,2);			//	Start Measurement
 	i2cBuf[0] = ACCEL_SNCR_DATA_FORMAT; i2cBuf[1] = 0x04;
@@ -770,49 +1057,24 @@ void adxl345_init( unsigned char chipnum )
 #endif
 }
 //-------------------------------------------------------------------------
+//	value[3] : X,Y,Z ( Left Justified: 1g = 16384 )
+//		all axes by one burst read, so they are of the same sample
+//-------------------------------------------------------------------------
 int adxl345_getAccel( unsigned char chipnum, signed short* value )
 {
-	unsigned short tmp;
-	unsigned char reg[2];
-	unsigned char adrs;
+	unsigned char reg[6];
+	unsigned char adrs = ACCEL_SNCR_DATAX0;
 	unsigned char i2cadrs = ADXL345_I2C_ADRS;
 	int err;
 
 	if ( chipnum == 1 ){ i2cadrs = ADXL345_I2C_ADRS2; }
 
-	adrs = 0x32;
-	err = read_nbyte_i2cDevice( i2cadrs, &adrs, reg, 1, 2 );
-	if (!err){
-		tmp = reg[0];
-		tmp |= (unsigned short)reg[1] << 8;
-		*value = (signed short)tmp;
+	err = read_nbyte_i2cDevice( i2cadrs, &adrs, reg, 1, 6 );
+	for ( int i=0; i<3; i++ ){
+		if ( err ){ value[i] = 0; }
+		else { value[i] = static_cast<signed short>(reg[i*2] | (static_cast<unsigned short>(reg[i*2+1]) << 8)); }
 	}
-	else {
-		*value = 0;
-	}
-
-	adrs = 0x34;
-	err = read_nbyte_i2cDevice( i2cadrs, &adrs, reg, 1, 2 );
-	if (!err){
-		tmp = reg[0];
-		tmp |= (unsigned short)reg[1] << 8;
-		*(value+1) = (signed short)tmp;
-	}
-	else {
-		*(value+1) = 0;
-	}
-
-	adrs = 0x36;
-	err = read_nbyte_i2cDevice( i2cadrs, &adrs, reg, 1, 2 );
-	if (!err){
-		tmp = reg[0];
-		tmp |= (unsigned short)reg[1] << 8;
-		*(value+2) = (signed short)tmp;
-	}
-	else {
-		*(value+2) = 0;
-	}
-	return 0;
+	return err;
 }
 #endif
 
@@ -820,52 +1082,108 @@ int adxl345_getAccel( unsigned char chipnum, signed short* value )
 //			PCA9685 (LED Driver : I2c Device)
 //-------------------------------------------------------------------------
 #ifdef USE_PCA9685    //	for LED Driver
+#define		PCA9685_LED_TOP			0x06	//	LED0_ON_L
+#define		PCA9685_LED_REG_SZ		64		//	LED0_ON_L - LED15_OFF_H
+#define		PCA9685_BURST_MAX		30		//	Wire buffer is 32 with register address
+static const unsigned char PCA9685_ADDRESS = 0x40;
+
+//	Shadow of LED registers, and range to be written
+static unsigned char pca9685Shadow[PCA9685_CHIP_MAX][PCA9685_LED_REG_SZ];
+static unsigned char pca9685DirtyTop[PCA9685_CHIP_MAX];
+static unsigned char pca9685DirtyEnd[PCA9685_CHIP_MAX];	//	0 means clean
+//-------------------------------------------------------------------------
+static bool PCA9685_exists( int chipNumber )
+{
+	return ( chipNumber >= 0 ) && ( chipNumber < PCA9685_CHIP_MAX );
+}
 //-------------------------------------------------------------------------
-int PCA9685_write( int chipNumber, uint8 cmd1, uint8 cmd2 )
+int PCA9685_write( int chipNumber, unsigned char cmd1, unsigned char cmd2 )
 {
-	static const unsigned char PCA9685_ADDRESS = 0x40;
 	unsigned char	i2cBuf[2];
 	int		err = 0;
+	if ( PCA9685_exists(chipNumber) == false ){ return -1; }
 	i2cBuf[0] = cmd1; i2cBuf[1] = cmd2;
 	err = write_i2cDevice( PCA9685_ADDRESS+chipNumber, i2cBuf, 2 );
 	return err;
 }
 //-------------------------------------------------------------------------
+static void PCA9685_setShadow( int chipNumber, unsigned char reg, unsigned char value )
+{
+	if ( pca9685Shadow[chipNumber][reg] == value ){ return; }
+	pca9685Shadow[chipNumber][reg] = value;
+	if ( pca9685DirtyEnd[chipNumber] == 0 ){
+		pca9685DirtyTop[chipNumber] = reg;
+		pca9685DirtyEnd[chipNumber] = reg+1;
+	}
+	else {
+		if ( reg < pca9685DirtyTop[chipNumber] ){ pca9685DirtyTop[chipNumber] = reg; }
+		if ( reg >= pca9685DirtyEnd[chipNumber] ){ pca9685DirtyEnd[chipNumber] = reg+1; }
+	}
+}
+//-------------------------------------------------------------------------
 //		Initialize
 //-------------------------------------------------------------------------
 void PCA9685_init( int chipNumber )
 {
+	if ( PCA9685_exists(chipNumber) == false ){ return; }
+
 	//	Init Parameter
-	PCA9685_write( chipNumber, 0x00, 0x00 );
+	PCA9685_write( chipNumber, 0x00, 0x20 );//	Auto-Increment
 	PCA9685_write( chipNumber, 0x01, 0x12 );//	Invert, OE=high-impedance
+
+	//	all registers are written by the first flush
+	for ( int i=0; i<PCA9685_LED_REG_SZ; i++ ){ pca9685Shadow[chipNumber][i] = 0; }
+	pca9685DirtyTop[chipNumber] = 0;
+	pca9685DirtyEnd[chipNumber] = PCA9685_LED_REG_SZ;
 }
 //-------------------------------------------------------------------------
 //		rNum, gNum, bNum : 0 - 4094  bigger, brighter
+//		only shadow is changed, sent by PCA9685_flush()
 //-------------------------------------------------------------------------
 int PCA9685_setFullColorLED( int chipNumber, int ledNum, unsigned short* color  )
 {
-  int err = 0;
 	int	i;
 
+	if ( PCA9685_exists(chipNumber) == false ){ return -1; }
   ledNum &= 0x03;
 	for ( i=0; i<3; i++ ){
 		//	figure out PWM counter
 		unsigned short colorCnt = *(color+i);
 		colorCnt = 4095 - colorCnt;
-		if ( colorCnt <= 0 ){ colorCnt = 1;}
+		if ( colorCnt == 0 ){ colorCnt = 1;}
 
 		//	Set PWM On Timing
-		err = PCA9685_write( chipNumber, (uint8)(0x06 + i*4 + ledNum*16), (uint8)(colorCnt & 0x00ff) );
-        if ( err != 0 ){ return err; }
-		err = PCA9685_write( chipNumber, (uint8)(0x07 + i*4 + ledNum*16), (uint8)((colorCnt & 0xff00)>>8) );
-        if ( err != 0 ){ return err; }
-
-		err = PCA9685_write( chipNumber, (uint8)(0x08 + i*4 + ledNum*16), 0 );
-        if ( err != 0 ){ return err; }
-		err = PCA9685_write( chipNumber, (uint8)(0x09 + i*4 + ledNum*16), 0 );
-        if ( err != 0 ){ return err; }
+		unsigned char reg = static_cast<unsigned char>(i*4 + ledNum*16);
+		PCA9685_setShadow( chipNumber, reg, (unsigned char)(colorCnt & 0x00ff) );
+		PCA9685_setShadow( chipNumber, reg+1, (unsigned char)((colorCnt & 0xff00)>>8) );
+		PCA9685_setShadow( chipNumber, reg+2, 0 );
+		PCA9685_setShadow( chipNumber, reg+3, 0 );
 	}
-    return err;
+    return 0;
+}
+//-------------------------------------------------------------------------
+//		Write changed range by auto-increment ( flushLed() of 10msec frame )
+//-------------------------------------------------------------------------
+int PCA9685_flush( int chipNumber )
+{
+	unsigned char	i2cBuf[PCA9685_BURST_MAX+1];
+	int		err = 0;
+
+	if ( PCA9685_exists(chipNumber) == false ){ return -1; }
+	while ( pca9685DirtyEnd[chipNumber] != 0 ){
+		unsigned char top = pca9685DirtyTop[chipNumber];
+		int length = pca9685DirtyEnd[chipNumber] - top;
+		if ( length > PCA9685_BURST_MAX ){ length = PCA9685_BURST_MAX; }
+
+		i2cBuf[0] = PCA9685_LED_TOP + top;
+		for ( int i=0; i<length; i++ ){ i2cBuf[i+1] = pca9685Shadow[chipNumber][top+i]; }
+		err = write_i2cDevice( PCA9685_ADDRESS+chipNumber, i2cBuf, length+1 );
+		if ( err != 0 ){ return err; }		//	retry by next flush
+
+		if ( top+length >= pca9685DirtyEnd[chipNumber] ){ pca9685DirtyEnd[chipNumber] = 0; }
+		else { pca9685DirtyTop[chipNumber] = top+length; }
+	}
+	return err;
 }
 #endif
 
@@ -899,7 +1217,12 @@ int pca9544_changeI2cBus( int i2c )
 {
 	unsigned char	i2cBuf = 0x04 | (i2c&0x0003);
 	int		err = 0;
+
+	//	don't switch if already selected
+	if ( (i2c&0x0003) == pca9544CrntBus ){ return 0; }
+
 	err = write_i2cDevice( PCA9544A_I2C_ADRS, &i2cBuf, 1 );
+	pca9544CrntBus = ( err == 0 )? (i2c&0x0003):-1;
 	return err;
 }
 #endif
@@ -13,15 +13,23 @@
 
 void wireBegin( void );
 void initHardware( void );
+int i2c_recoverBus( void );
+
+//  Err Code ( 1-4: Wire, 5: Wire timeout )
+#define I2C_ERR_OFFLINE   6     //  device is recovering
+extern int i2cErrCode;          //  last error, cleared by caller
 
 // USE_CY8CMBR3110
 	int MBR3110_init( int number=0 );
   int MBR3110_setup( int number=0 );
-	int MBR3110_readData( unsigned char cmd, unsigned char* data, int length, unsigned char i2cAdrs );
-	int MBR3110_selfTest( unsigned char* result, int number );
+  #define MBR3110_RETRY_MAX   500   //  msec, for init
+  int MBR3110_reinitStep( int* wait );
+	int MBR3110_readData( unsigned char cmd, unsigned char* data, int length, unsigned char i2cAdrs, int retry=MBR3110_RETRY_MAX );
+	int MBR3110_selfTest( unsigned char* result, int number, int retry=MBR3110_RETRY_MAX );
 	void MBR3110_changeSensitivity( unsigned char data, int number=0 );
   int MBR3110_readTouchSw( unsigned char* touchSw, int number=0 );
-	int MBR3110_checkWriteConfig( unsigned char checksumL, unsigned char checksumH, unsigned char crntI2cAdrs );
+  int MBR3110_scanTouchSw( unsigned long* keys );
+	int MBR3110_checkWriteConfig( unsigned char checksumL, unsigned char checksumH, unsigned char crntI2cAdrs, int retry=MBR3110_RETRY_MAX );
 	int MBR3110_writeConfig( int number, unsigned char crntI2cAdrs );
 
 // USE_ADA88
@@ -32,6 +40,16 @@ void initHardware( void );
 // USE_AP4
   int ap4_getAirPressure( void );
 
+// USE_LPS22HB
+  #define LPS_BURST_MAX   6     //  samples by one Wire buffer (32byte)
+  int lps22hb_init( void );
+  int lps22hb_readFifo( long* prs, int max, int* num );
+
+// USE_LPS25H
+  int lps25h_init( void );
+  int lps25h_readFifo( long* prs, int max, int* num );
+  uint16_t lps25h_overrunCount( void );   //  since power on
+
 // USE_AQM1602XA
 	void aqm1602xa_init( void );
 	void aqm1602xa_setStringUpper( int locate, char* str, int strNum );
@@ -43,6 +61,7 @@ void initHardware( void );
 // USE_PCA9685
 	void PCA9685_init( int chipNumber );
 	int PCA9685_setFullColorLED( int chipNumber, int ledNum, unsigned short* color  );
+	int PCA9685_flush( int chipNumber );
 
 // USE_ATTINY
 	int attiny_setLed( unsigned char ledPtn );
@@ -14,10 +14,17 @@
 #include "configuration.h"
 #include "i2cdevice.h"
 #include  "air_pressure.h"
+#include  "profiler.h"
+#include  "parameter.h"
+#include  "player_storage.h"
+#include  "harmonizer.h"
+#include  "note_tracker.h"
+#include  "trace.h"
+#include  "motion.h"
 
 //-------------------------------------------------------------------------
 //  Adjustable Value
-#define     DEADBAND_POINT_TIME     6      //  ×10[msec]
+#define     DEADBAND_POINT_TIME     prm(PRM_DEADBAND_POINT_TIME)    //  ×10[msec]
 //-------------------------------------------------------------------------
 #define     OCT_SW      0x30
 #define     CRO_SW      0x08
@@ -30,17 +37,28 @@
 #define     MAX_TRANSPOSE       5
 #define     MIN_TRANSPOSE       (-6)
 
-#define     MUTE_TIME           5    //  *100 [msec]
+#define     MUTE_TIME           prm(PRM_MUTE_TIME)    //  *100 [msec]
+#define     STORE_INTERVAL      600  //  *100 [msec]
+
+#define     BEND_CENTER         0x2000
+#define     BEND_MIN_DIFF       16
+#define     VIB_RATE_CENTER     55    //  5.5Hz -> CC#76 64
 
 //-------------------------------------------------------------------------
 #ifdef USE_AIR_PRESSURE
 AirPressure ap;
 #endif
+static PlayerStorage ps;
+static Harmonizer hz;
+#ifdef USE_ADXL345
+static Motion mo;
+#endif
+NoteTracker nt;
 
 extern GlobalTimer gt;
 
 //-------------------------------------------------------------------------
-const unsigned char MagicFlute::swTable[64] = {
+const FlashTable<uint8_t,64> MagicFlute::swTable PROGMEM = {
 
 //   ooo   oox   oxo   oxx   xoo   xox   xxo   xxx  right hand (x:hold, o:open)
 //  do(hi) so    fa    la    mi    ti    re    do
@@ -65,6 +83,102 @@ const unsigned char MagicFlute::swTable[64] = {
 
 };
 
+/*----------------------------------------------------------------------------*/
+//
+//     Restore Player State
+//
+/*----------------------------------------------------------------------------*/
+void MagicFlute::init( void )
+{
+  int prs = 0;
+  if ( ps.load(_toneNumber, _transpose, prs) == true ){
+    if (( _toneNumber < 0 ) || ( _toneNumber >= MAX_TONE_NUMBER_WITH_OCT )){ _toneNumber = 0;}
+    if (( _transpose < MIN_TRANSPOSE ) || ( _transpose > MAX_TRANSPOSE )){ _transpose = 0;}
+#ifdef USE_AIR_PRESSURE
+    ap.restoreStandardPressure(prs);
+#endif
+    _storedStandard = prs;    //  not written again until it moves
+  }
+  sendProgramChange();
+#ifdef USE_AIR_PRESSURE
+  ap.init();
+#endif
+#ifdef USE_ADXL345
+  mo.init();
+#endif
+}
+/*----------------------------------------------------------------------------*/
+void MagicFlute::sendProgramChange( void )
+{
+  setMidiBuffer( 0xc0, _toneNumber%MAX_TONE_NUMBER, 0xff );
+  hz.programChange(_toneNumber%MAX_TONE_NUMBER);
+}
+/*----------------------------------------------------------------------------*/
+void MagicFlute::storePlayerState( void )
+{
+  int prs = 0;
+#ifdef USE_AIR_PRESSURE
+  prs = ap.standardPressure();
+#endif
+  ps.save(_toneNumber, _transpose, prs);
+  _storedStandard = prs;
+}
+/*----------------------------------------------------------------------------*/
+//
+//     Remote Control by MIDI Input
+//
+/*----------------------------------------------------------------------------*/
+void MagicFlute::setTone( uint8_t number )
+{
+  //  4-7 are an octave lower
+  _toneNumber = static_cast<int8_t>(number % MAX_TONE_NUMBER_WITH_OCT);
+  sendProgramChange();
+  storePlayerState();
+  _ledIndicatorCntr = 1;
+}
+/*----------------------------------------------------------------------------*/
+void MagicFlute::setTranspose( int value )
+{
+  //  a sounding note is released by its own pitch, so any time is OK
+  if ( value > MAX_TRANSPOSE ){ value = MAX_TRANSPOSE;}
+  if ( value < MIN_TRANSPOSE ){ value = MIN_TRANSPOSE;}
+  _transpose = static_cast<int8_t>(value);
+  storePlayerState();
+  _ledIndicatorCntr = 101;
+}
+/*----------------------------------------------------------------------------*/
+void MagicFlute::clockBeat( void )
+{
+  //  LED flashes at next 10msec, not waiting for 100msec
+  _beatLedCntr = BEAT_LED_TIME;
+  _beatLedRedraw = true;
+}
+/*----------------------------------------------------------------------------*/
+//
+//     Device State as SysEx
+//        F0 7D 37 ( id online errors(2) overruns(2) )... F7
+//          id 0: pressure sensor, 1: touch, 2: ADXL345, 3: ADA88, 4: PCA9685
+//          only the devices of configuration.h
+//          errors: I2C errors, overruns: FIFO overruns, since power on
+//          each count is 14bit in 7bit bytes, MSB first
+//
+/*----------------------------------------------------------------------------*/
+void MagicFlute::reportDevices( void )
+{
+  uint8_t buf[2+DEV_REPORT_SIZE*DEV_ID_MAX];
+  uint8_t* p = buf;
+  *p++ = 0x7d;    //  non-commercial
+  *p++ = 0x37;    //  device report
+#ifdef USE_AIR_PRESSURE
+  p = ap.sensorHealth().put(p, DEV_ID_PRESSURE, ap.sensorOverrun());
+#endif
+  p = _touch.health().put(p, DEV_ID_TOUCH);
+#ifdef USE_ADXL345
+  p = mo.health().put(p, DEV_ID_MOTION);
+#endif
+  p = putOutputDeviceState(p);
+  setMidiSysEx(buf, static_cast<int>(p - buf));
+}
 /*----------------------------------------------------------------------------*/
 //
 //     Check Touch Sensor & Generate MIDI Event
@@ -72,14 +186,16 @@ const unsigned char MagicFlute::swTable[64] = {
 /*----------------------------------------------------------------------------*/
 void MagicFlute::checkSixTouch( void )
 {
-  uint8_t swb[2] = {0};
+  unsigned long keys = 0;
 
-#ifdef USE_CY8CMBR3110
-  int err = MBR3110_readTouchSw(swb);
+  PROF_BEGIN(PROF_TOUCH_SCAN);
+  int err = _touch.scan(&keys);
+  PROF_END(PROF_TOUCH_SCAN);
   if ( err != 0 ){ return;}
-#endif
 
-  _swState = ((uint16_t)swb[0]) | ((uint16_t)swb[1]<<8);
+  _keyState = static_cast<uint32_t>(keys);
+  _swState = static_cast<uint16_t>(keys & 0x03ff);   //  chip 0
+  TRACE_TOUCH(_keyState);
   uint8_t tch = 0;
   if ( _swState & 0x0020 ){ tch |= 0x01;}
   if ( _swState & 0x0010 ){ tch |= 0x02;}
@@ -96,23 +212,49 @@ void MagicFlute::checkSixTouch( void )
       if (newSwState == 0x03){
         if (_lastSwState == 0x02){
           if ( ++_toneNumber >= MAX_TONE_NUMBER_WITH_OCT ){ _toneNumber = 0; }
-          setMidiBuffer( 0xc0, _toneNumber%MAX_TONE_NUMBER, 0xff );
+          sendProgramChange();
+          storePlayerState();
           _ledIndicatorCntr = 1;
         }
         if (_lastSwState == 0x01){
           if ( --_toneNumber < 0 ){ _toneNumber = MAX_TONE_NUMBER_WITH_OCT-1; }
-          setMidiBuffer( 0xc0, _toneNumber%MAX_TONE_NUMBER, 0xff );
+          sendProgramChange();
+          storePlayerState();
           _ledIndicatorCntr = 1;
         }
       }
+      //  Breath Curve ( hold a tone key & touch a transpose key )
+      if ((_lastSwState == 0x01) || (_lastSwState == 0x02)){
+        if (newSwState == (_lastSwState|0x08)){
+          ap.changeCurve(1);
+          _ledIndicatorCntr = 201;
+        }
+        if (newSwState == (_lastSwState|0x04)){
+          ap.changeCurve(-1);
+          _ledIndicatorCntr = 201;
+        }
+      }
+      //  Harmony ( hold a transpose key & touch a tone key )
+      if ((_lastSwState == 0x04) || (_lastSwState == 0x08)){
+        if (newSwState == (_lastSwState|0x02)){
+          hz.changeMode(1);
+          _ledIndicatorCntr = 151;
+        }
+        if (newSwState == (_lastSwState|0x01)){
+          hz.changeMode(-1);
+          _ledIndicatorCntr = 151;
+        }
+      }
       //  Transpose
       if (newSwState == 0x0c){
         if (_lastSwState == 0x08){
           if ( ++_transpose > MAX_TRANSPOSE ){ _transpose = MAX_TRANSPOSE; }
+          storePlayerState();
           _ledIndicatorCntr = 101;
         }
         if (_lastSwState == 0x04){
           if ( --_transpose < MIN_TRANSPOSE ){ _transpose = MIN_TRANSPOSE; }
+          storePlayerState();
           _ledIndicatorCntr = 101;
         }
       }
@@ -121,30 +263,72 @@ void MagicFlute::checkSixTouch( void )
   }
 }
 /*----------------------------------------------------------------------------*/
+bool MagicFlute::isIdle( void ) const
+{
+  if (( _nowPlaying == true ) || ( _muteCounter != 0 ) || ( _swState != 0 ) ||
+      ( _ledIndicatorCntr != 0 ) || ( _beatLedCntr != 0 )){ return false;}
+#ifdef USE_AIR_PRESSURE
+  //  wake up at the start of a breath, Note On comes as from the awake loop
+  if ( ap.breathSensed() == true ){ return false;}
+#endif
+  return true;
+}
+/*----------------------------------------------------------------------------*/
 int MagicFlute::midiOutAirPressure( void )
 {
   int prs = 0;
 #ifdef USE_AIR_PRESSURE
-  prs = ap.getPressure();
+  prs = ap.getPressure(isIdle());
+  if (( ap.tonguingEvent() == true ) && ( nowPlaying() == true )){
+    //  Retrigger without waiting for 10msec
+    uint8_t oct = (_toneNumber/MAX_TONE_NUMBER)*12;
+    _velocity = ap.attackVelocity();
+    nt.noteOn( LEAD_CH, _soundingNote, _velocity );   //  Note Off is sent before
+    hz.noteOn( _crntNote, _transpose+oct, _velocity );
+  }
   if ( gt.timer10msecEvent() == true ){
+    const uint8_t lastExp = _midiExp;
     if ( ap.generateExpEvent(midiExpPtr()) == true ){
       uint8_t oct = (_toneNumber/MAX_TONE_NUMBER)*12;
       if (( nowPlaying() == false ) && ( _midiExp > 0 )){
         _nowPlaying = true;
         setMute(false);
         _muteCounter = 1000;  //  100sec
-        setMidiBuffer( 0x90, _crntNote+_transpose+oct, 0x7f );
+        _velocity = ap.attackVelocity();
+#ifdef USE_ADXL345
+        //  posture at attack is the center of bend
+        mo.setReference();
+        sendPitchBend(BEND_CENTER);
+#endif
+        _soundingNote = _crntNote+_transpose+oct;
+        nt.noteOn( LEAD_CH, _soundingNote, _velocity );
+        hz.noteOn( _crntNote, _transpose+oct, _velocity );
         _doremi = _crntNote%12;
       }
       else if (( nowPlaying() == true ) && ( _midiExp == 0 )){
         _nowPlaying = false;
         _muteCounter = MUTE_TIME;
-        setMidiBuffer( 0x80, _crntNote+_transpose+oct, 0x40 );
+        nt.releaseChannel( LEAD_CH );   //  whatever is sounding
+        _soundingNote = NO_NOTE;
+        hz.noteOff();
         _doremi = 12;
       }
+#if ( EXP_OUTPUT == EXP_OUT_14BIT )
+      //  MSB resets LSB on the receiver, so MSB is sent only when changed
+      const uint16_t exp14 = ap.expression14();
+      if ( _midiExp != lastExp ){
+        setMidiBuffer( 0xb0, 0x0b, _midiExp );
+      }
+      setMidiBuffer( 0xb0, 0x2b, static_cast<uint8_t>(exp14 & 0x7f) );
+#else
       setMidiBuffer( 0xb0, 0x0b, _midiExp );
-      setMidiBuffer( 0xb0, 0x01, (_midiExp>>3)+32 );
+#endif
+      if ( _midiExp != lastExp ){ hz.expression(_midiExp);}
+      sendModulation();
     }
+#ifdef USE_BREATH_VIBRATO
+    midiOutVibrato();
+#endif
   }
 #endif
   return prs;
@@ -153,18 +337,115 @@ int MagicFlute::midiOutAirPressure( void )
 void MagicFlute::periodic100msec( void )
 {
   setNeoPixel();
+  if ( _beatLedCntr != 0 ){ _beatLedCntr -= 1;}
   if ( _muteCounter != 0 ){
     _muteCounter -= 1;
     if (( _muteCounter == 0 ) && ( _nowPlaying == false )){
       setMute(true);
     }
   }
+
+#ifdef USE_AIR_PRESSURE
+  //  Store standard pressure when it moved
+  if ( ++_storeCounter >= STORE_INTERVAL ){
+    _storeCounter = 0;
+    int diff = ap.standardPressure() - _storedStandard;
+    if ( diff < 0 ){ diff = -diff;}
+    if (( _nowPlaying == false ) && ( diff > prm(PRM_NOISE_WIDTH) )){
+      storePlayerState();
+    }
+  }
+#endif
+}
+//-------------------------------------------------------------------------
+void MagicFlute::periodic10msec( void )
+{
+  ps.periodic();
+#ifdef USE_ADXL345
+  PROF_BEGIN(PROF_MOTION);
+  mo.update();
+  PROF_END(PROF_MOTION);
+  midiOutMotion();
+#endif
+  if ( _beatLedRedraw == true ){
+    _beatLedRedraw = false;
+    setNeoPixel();
+  }
+}
+//-------------------------------------------------------------------------
+void MagicFlute::periodic1sec( void )
+{
+  //  All Note Off after silence, for a lost Note Off on the receiver
+  nt.refresh();
 }
 
 
 /*----------------------------------------------------------------------------*/
 //    private functions
 /*----------------------------------------------------------------------------*/
+void MagicFlute::midiOutMotion( void )
+{
+#ifdef USE_ADXL345
+  //  silent: back to the center once, the next attack sets the reference
+  const uint16_t bend = ( nowPlaying() == true )? mo.pitchBend():BEND_CENTER;
+  int diff = static_cast<int>(bend) - static_cast<int>(_lastBend);
+  if ( diff < 0 ){ diff = -diff;}
+  if (( diff >= BEND_MIN_DIFF ) || (( bend == BEND_CENTER ) && ( diff != 0 ))){
+    sendPitchBend(bend);
+  }
+  _shakeDepth = mo.shakeDepth();
+  sendModulation();
+#endif
+}
+//-------------------------------------------------------------------------
+void MagicFlute::sendPitchBend( uint16_t bend )
+{
+  if ( bend == _lastBend ){ return;}
+  setMidiBuffer( 0xe0, bend & 0x7f, (bend>>7) & 0x7f );
+  hz.pitchBend(bend);
+  _lastBend = bend;
+}
+//-------------------------------------------------------------------------
+void MagicFlute::sendModulation( void )
+{
+#if defined(USE_AIR_PRESSURE) && defined(USE_BREATH_VIBRATO)
+  //  breath vibrato and shake
+  int mod = _shakeDepth;
+  if ( nowPlaying() == true ){ mod += ap.vibrato().depth();}
+#else
+  //  breath and shake
+  int mod = (_midiExp>>3) + 32 + _shakeDepth;
+#endif
+  if ( mod > 127 ){ mod = 127;}
+  if ( mod != _lastModulation ){
+    setMidiBuffer( 0xb0, 0x01, static_cast<uint8_t>(mod) );
+    _lastModulation = static_cast<uint8_t>(mod);
+  }
+}
+//-------------------------------------------------------------------------
+void MagicFlute::midiOutVibrato( void )
+{
+#if defined(USE_AIR_PRESSURE) && defined(USE_BREATH_VIBRATO)
+  const Vibrato& vb = ap.vibrato();
+  sendModulation();
+
+  //  rate is kept while vibrato stops
+  if (( nowPlaying() == true ) && ( vb.depth() != 0 )){
+    int rate = 64 + (static_cast<int>(vb.rate()) - VIB_RATE_CENTER)*2;
+    if ( rate < 0 ){ rate = 0;}
+    else if ( rate > 127 ){ rate = 127;}
+    if ( rate != _lastVibRate ){
+      setMidiBuffer( 0xb0, 0x4c, static_cast<uint8_t>(rate) );
+      _lastVibRate = static_cast<uint8_t>(rate);
+    }
+  }
+  if ( vb.growlDepth() != _lastGrowl ){
+    setMidiBuffer( 0xb0, 0x10, vb.growlDepth() );
+    _lastGrowl = vb.growlDepth();
+  }
+#endif
+}
+//-------------------------------------------------------------------------
 void MagicFlute::setNewTouch( uint8_t tch )
 {
   if ( _crntTouch != tch ){
@@ -173,6 +454,11 @@ void MagicFlute::setNewTouch( uint8_t tch )
   }
 }
 //-------------------------------------------------------------------------
+uint8_t MagicFlute::fingeringNote( uint8_t tch )
+{
+  return swTable[tch & ALL_SW];
+}
+//-------------------------------------------------------------------------
 uint8_t MagicFlute::getNewNote( void )
 {
   _lastSw = swTable[_crntTouch & ALL_SW];
@@ -232,13 +518,12 @@ bool MagicFlute::catchEventOfPeriodic( uint8_t& midiValue, uint32_t crntTime )
   bool    ret = false;
 
   if ( _crntTouch == _lastTouch ){
+    //  _deadBand is the armed flag, since _startTime can be 0 as a real time
     if ( _deadBand > 0 ){
-      if ( _startTime != 0 ){
-        if ( crntTime-_startTime > DEADBAND_POINT_TIME*_deadBand ){
-          //  NoteOn
-          midiValue = getNewNote();
-          ret = true;
-        }
+      if ( crntTime-_startTime > static_cast<uint32_t>(DEADBAND_POINT_TIME*_deadBand) ){
+        //  NoteOn
+        midiValue = getNewNote();
+        ret = true;
       }
     }
   }
@@ -277,15 +562,14 @@ void MagicFlute::analyseSixTouchSens( uint8_t tch )
     if ( catchEventOfPeriodic(mdNote, gt.timer10ms()) == true ){
       uint8_t oct = (_toneNumber/MAX_TONE_NUMBER)*12;
       if ( _nowPlaying == true ){
-        if ( mdNote != _crntNote ){
-          setMidiBuffer( 0x90, mdNote+_transpose+oct, 0x7f );
-          setMidiBuffer( 0x80, _crntNote+_transpose+oct, 0x40 );
-        }
-        else {
-          // Same Note
-          setMidiBuffer( 0x80, mdNote+_transpose+oct, 0x40 );
-          setMidiBuffer( 0x90, mdNote+_transpose+oct, 0x7f );
+        const uint8_t newNote = mdNote+_transpose+oct;
+        //  Same Note is retriggered by NoteTracker
+        nt.noteOn( LEAD_CH, newNote, _velocity );
+        if ( newNote != _soundingNote ){
+          nt.noteOff( LEAD_CH, _soundingNote );
         }
+        _soundingNote = newNote;
+        hz.noteOn( mdNote, _transpose+oct, _velocity );
         _doremi = mdNote%12;
       }
       else {
@@ -311,7 +595,29 @@ void MagicFlute::indicateToneAndTranspose( void )
     _ledIndicatorCntr = 0;
   }
   else {
-    if ( _ledIndicatorCntr > 100 ){
+    if ( _ledIndicatorCntr > 200 ){
+      //  Indicate Breath Curve
+      ++_ledIndicatorCntr;
+      if ( _ledIndicatorCntr > 203 ){
+        indicateParticularLed(_ALL_CLEAR,0,0,0);
+        _ledIndicatorCntr = 0;
+      }
+      else {
+        indicateParticularLed(ap.curveNumber(),60,60,60);
+      }
+    }
+    else if ( _ledIndicatorCntr > 150 ){
+      //  Indicate Harmony
+      ++_ledIndicatorCntr;
+      if ( _ledIndicatorCntr > 153 ){
+        indicateParticularLed(_ALL_CLEAR,0,0,0);
+        _ledIndicatorCntr = 0;
+      }
+      else {
+        indicateParticularLed(hz.mode(),80,0,80);
+      }
+    }
+    else if ( _ledIndicatorCntr > 100 ){
       //  Indicate Transpose
       ++_ledIndicatorCntr;
       if ( _ledIndicatorCntr > 103 ){
@@ -381,6 +687,10 @@ void MagicFlute::setNeoPixel( void )
   if ( _ledIndicatorCntr > 0 ){
     indicateToneAndTranspose();
   }
+  else if (( _beatLedCntr > 0 ) && ( _nowPlaying == false )){
+    //  MIDI Clock Beat
+    for ( int i=0; i<MAX_LED; i++ ){ setLed(i,30,30,30);}
+  }
   else {
     indicatePitchAndExpression();
   }
@@ -14,27 +14,58 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include "flash_table.h"
+#include "product.h"
 
 void initSixTouch( void );
 void checkSixTouch( void );
 
 class MagicFlute {
 public:
-  MagicFlute() : _swState(0), _lastTouch(0), _crntTouch(0), _tapTouch(0),
+  MagicFlute() : _keyState(0), _swState(0), _lastTouch(0), _crntTouch(0), _tapTouch(0),
                  _lastSw(0x24),    //  any touch senser isn't on
                  _crntNote(96), _doremi(12), _nowPlaying(false), _muteCounter(1000),
-                 _midiExp(0), _startTime(0), _deadBand(0), 
+                 _midiExp(0), _velocity(0x7f), _lastModulation(0xff), _soundingNote(NO_NOTE),
+                 _lastBend(0x2000), _shakeDepth(0), _lastVibRate(0xff), _lastGrowl(0),
+                 _startTime(0), _deadBand(0), 
                  _lastSwState(0), _toneNumber(0), _transpose(0),
-                 _ledIndicatorCntr(0) {}
+                 _ledIndicatorCntr(0), _beatLedCntr(0), _beatLedRedraw(false),
+                 _storeCounter(0), _storedStandard(0), _touch() {}
 
   MagicFlute(const MagicFlute& orig);
 //  virtual ~MagicFlute(){}
 
+  int     initTouch( void ){ return _touch.init();}
+  void    init( void );
   void    checkSixTouch( void );
   int     midiOutAirPressure( void );
+  void    periodic10msec( void );
   void    periodic100msec( void );
+  void    periodic1sec( void );
+
+  //  Remote Control
+  void    setTone( uint8_t number );
+  void    setTranspose( int value );
+  void    clockBeat( void );
+  void    reportDevices( void );
+
+  //  all keys of CY8CMBR3110s, 10 keys each
+  uint32_t  keyState( void ) const { return _keyState;}
+
+  //  for diagnostics: note decided by fingering, and the note of a fingering
+  uint8_t   crntNote( void ) const { return _crntNote;}
+  static uint8_t  fingeringNote( uint8_t tch );
+
+  //  not blowing, no touch, and nothing to indicate
+  bool    isIdle( void ) const;
 
 private:
+  void    sendProgramChange( void );
+  void    midiOutMotion( void );
+  void    sendPitchBend( uint16_t bend );
+  void    sendModulation( void );
+  void    midiOutVibrato( void );
+  void    storePlayerState( void );
   void    setNewTouch( uint8_t tch );
   uint8_t getNewNote( void );
   bool    decideDeadBand_byNoteDiff( uint8_t& midiValue, uint32_t crntTime, int diff );
@@ -55,11 +86,15 @@ private:
 
   static const int _MAX_TOUCH_SW = 6;
   static const int _ALL_CLEAR = _MAX_TOUCH_SW;
+  static const uint8_t LEAD_CH = 0;
+  static const uint8_t NO_NOTE = 0xff;
+  static const uint8_t BEAT_LED_TIME = 1;   //  *100 [msec]
 
-  static const unsigned char swTable[];
+  static const FlashTable<uint8_t,64> swTable;
 
 //  Detect Note
-  uint16_t    _swState;     //  raw touch switch state
+  uint32_t    _keyState;    //  all touch chips
+  uint16_t    _swState;     //  raw touch switch state ( chip 0 )
   uint8_t     _lastTouch;   //  touch state before 10msec
   uint8_t     _crntTouch;   //  current touch state
   uint8_t     _tapTouch;
@@ -71,16 +106,31 @@ private:
   bool        _nowPlaying;  //  blowing now
   uint16_t    _muteCounter;
   uint8_t     _midiExp;
+  uint8_t     _velocity;    //  of the sounding note
+  uint8_t     _lastModulation;
+  uint8_t     _soundingNote;  //  pitch sent by Note On
+  uint16_t    _lastBend;
+  uint8_t     _shakeDepth;    //  by Motion
+  uint8_t     _lastVibRate;   //  CC#76
+  uint8_t     _lastGrowl;     //  CC#16
 
 //  Time Measurement
-  uint32_t    _startTime;  //  !=0 means during deadBand
-  int         _deadBand;
+  uint32_t    _startTime;  //  start of deadBand
+  int         _deadBand;   //  >0 means during deadBand
 
 //  Voice Change / Transpose
   uint8_t     _lastSwState;
   int8_t      _toneNumber;
   int8_t      _transpose;
-  uint8_t     _ledIndicatorCntr;  //  0, 1-3, 101-103
+  uint8_t     _ledIndicatorCntr;  //  0, 1-3, 101-103, 151-153, 201-203
+  uint8_t     _beatLedCntr;
+  bool        _beatLedRedraw;
+
+//  Player State Storage
+  uint16_t    _storeCounter;
+  int         _storedStandard;
+
+  TouchDevice _touch;
 
 };
 #endif  /* MAGIC_FLUTE_H */
@@ -0,0 +1,96 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  main_loop.cpp
+ *    description: Body of loop()
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#include "main_loop.h"
+#include "TouchMIDI_AVR_if.h"
+#include "configuration.h"
+#include "profiler.h"
+#include "trace.h"
+
+extern GlobalTimer gt;
+
+/*----------------------------------------------------------------------------*/
+//
+//     Global Timer
+//
+/*----------------------------------------------------------------------------*/
+static void generateTimer( MagicFlute& mf )
+{
+  gt.updateTimer();
+
+  if ( gt.timer10msecEvent() == true ){
+    TRACE_TICK(gt.timer10ms());
+    mf.periodic10msec();
+    flushLed();
+  }
+
+  if ( gt.timer1secEvent() == true ){
+    //  let a receiver recover from a lost status byte
+    clearMidiRunningStatus();
+    mf.periodic1sec();
+  }
+
+  if ( gt.timer100msecEvent() == true ){
+    PROF_BEGIN(PROF_PERIODIC);
+    mf.periodic100msec();
+    PROF_END(PROF_PERIODIC);
+
+    // blink LED
+    indicateAlive(( gt.timer100ms() & 0x0002 )? true:false);
+  }
+}
+/*----------------------------------------------------------------------------*/
+void main_loop( MagicFlute& mf, MidiReceiver& midiIn )
+{
+  PROF_BEGIN(PROF_LOOP);
+
+  //  Global Timer 
+  generateTimer(mf);
+
+  //  MIDI Input
+  int rx;
+  while (( rx = midiRxRead() ) >= 0 ){
+    TRACE_MIDI_RX(static_cast<uint8_t>(rx));
+    midiIn.receive(static_cast<uint8_t>(rx));
+  }
+
+#ifdef USE_IDLE_SLEEP
+  //  Idle: touch is read only at 10msec tick, which is when Note On is decided.
+  //  Breath is sampled once a sample period as in the awake loop, so the
+  //  moving average and the attack slope see the same spacing, and the
+  //  start of a breath wakes loop() up ( MagicFlute::isIdle() )
+  if (( mf.isIdle() == true ) && ( gt.timer10msecEvent() == false )){
+    mf.midiOutAirPressure();
+    flushMidiLowPriority();
+    idleSleep();
+    PROF_END(PROF_LOOP);
+    return;
+  }
+#endif
+
+  //  Air Pressure Sensor
+  PROF_BEGIN(PROF_BREATH);
+  int prs = mf.midiOutAirPressure();
+  PROF_END(PROF_BREATH);
+  setAda88_Number(prs/10);
+
+  //  Touch Sensor
+  PROF_BEGIN(PROF_TOUCH);
+  mf.checkSixTouch();
+  PROF_END(PROF_TOUCH);
+
+  //  after the lead note
+  flushMidiLowPriority();
+
+  delay(2);
+
+  PROF_END(PROF_LOOP);
+}
@@ -0,0 +1,23 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  main_loop.h
+ *    description: Body of loop()
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#ifndef MAIN_LOOP_H
+#define MAIN_LOOP_H
+
+#include "magicflute.h"
+#include "midi_receiver.h"
+
+//  One pass of loop(), called by SAXduino.ino and by the host simulation
+//  ( test/ ), so both run the same code. The platform gives
+//  midiRxRead(), idleSleep() and indicateAlive() of TouchMIDI_AVR_if.h.
+void main_loop( MagicFlute& mf, MidiReceiver& midiIn );
+
+#endif
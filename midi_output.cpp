@@ -0,0 +1,97 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  midi_output.cpp
+ *    description: MIDI Output ( running status, low priority queue )
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#include "TouchMIDI_AVR_if.h"
+#include "configuration.h"
+
+//  Bytes go to midiTxWrite() of the platform, which blocks while
+//  the TX buffer is full. midiTxRoom() is the free space of it.
+
+/*----------------------------------------------------------------------------*/
+static uint8_t midiRunningStatus = 0;
+void setMidiBuffer( uint8_t dt0, uint8_t dt1, uint8_t dt2 )
+{
+#ifdef USE_MIDI_RUNNING_STATUS
+  if ( dt0 != midiRunningStatus ){ midiTxWrite(dt0);}
+  midiRunningStatus = ( dt0 < 0xf0 )? dt0:0;
+#else
+  midiTxWrite(dt0);
+#endif
+  midiTxWrite(dt1);
+  if ( dt2 != 0xff ) midiTxWrite(dt2);
+}
+/*----------------------------------------------------------------------------*/
+//  Low Priority MIDI ( harmony voices etc. )
+//    sent only when Serial TX buffer has enough room for the lead note
+#define MIDI_TX_ROOM_FOR_LEAD   16
+static uint8_t midiLowPriorityBuf[MIDI_LOW_PRIORITY_MAX][3];
+static uint8_t midiLowPriorityTop = 0;
+static uint8_t midiLowPriorityCount = 0;
+static uint32_t midiLowPriorityStamp[MIDI_LOW_PRIORITY_MAX];  //  usec, 16bit wraps in 65msec
+static uint32_t midiLowPriorityWait = 0;
+static_assert( sizeof(midiRunningStatus) + sizeof(midiLowPriorityBuf) + sizeof(midiLowPriorityTop) +
+               sizeof(midiLowPriorityCount) + sizeof(midiLowPriorityStamp) + sizeof(midiLowPriorityWait)
+               == MIDI_OUTPUT_RAM, "MIDI_OUTPUT_RAM differs from the statics" );
+
+static void sendMidiLowPriority( void )
+{
+  const uint8_t* msg = midiLowPriorityBuf[midiLowPriorityTop];
+  setMidiBuffer( msg[0], msg[1], msg[2] );
+  const uint32_t wait = micros() - midiLowPriorityStamp[midiLowPriorityTop];
+  if ( wait > midiLowPriorityWait ){ midiLowPriorityWait = wait;}
+  midiLowPriorityTop = (midiLowPriorityTop+1)%MIDI_LOW_PRIORITY_MAX;
+  midiLowPriorityCount--;
+}
+void setMidiBufferLowPriority( uint8_t dt0, uint8_t dt1, uint8_t dt2 )
+{
+  //  never lose note off, send the oldest even if it blocks
+  if ( midiLowPriorityCount >= MIDI_LOW_PRIORITY_MAX ){ sendMidiLowPriority();}
+
+  uint8_t* msg = midiLowPriorityBuf[(midiLowPriorityTop+midiLowPriorityCount)%MIDI_LOW_PRIORITY_MAX];
+  msg[0] = dt0; msg[1] = dt1; msg[2] = dt2;
+  midiLowPriorityStamp[(midiLowPriorityTop+midiLowPriorityCount)%MIDI_LOW_PRIORITY_MAX] = micros();
+  midiLowPriorityCount++;
+}
+void flushMidiLowPriority( void )
+{
+  while (( midiLowPriorityCount > 0 ) && ( midiTxRoom() > MIDI_TX_ROOM_FOR_LEAD )){
+    sendMidiLowPriority();
+  }
+}
+uint32_t midiLowPriorityMaxWait( void )
+{
+  //  bounded by MIDI_LOW_PRIORITY_MAX messages, since a full queue sends the oldest
+  const uint32_t wait = midiLowPriorityWait;
+  midiLowPriorityWait = 0;
+  return wait;
+}
+/*----------------------------------------------------------------------------*/
+void setMidiRealtime( uint8_t dt )
+{
+  //  Realtime Message doesn't affect running status
+  midiTxWrite(dt);
+}
+/*----------------------------------------------------------------------------*/
+void clearMidiRunningStatus( void )
+{
+  //  next message starts with status byte
+  midiRunningStatus = 0;
+}
+/*----------------------------------------------------------------------------*/
+void setMidiSysEx( const uint8_t* data, int length )
+{
+  midiTxWrite(0xf0);
+  for ( int i=0; i<length; i++ ){
+    midiTxWrite(data[i] & 0x7f);
+  }
+  midiTxWrite(0xf7);
+  midiRunningStatus = 0;
+}
@@ -0,0 +1,205 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  midi_receiver.cpp
+ *    description: MIDI Input Parser
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#include "midi_receiver.h"
+#include "TouchMIDI_AVR_if.h"
+#include "configuration.h"
+#include "parameter.h"
+#include "profiler.h"
+#include "ram_monitor.h"
+
+#define   SYSEX_ID_NONCOMMERCIAL    0x7d
+
+#define   SX_CMD_PROFILE_DUMP       0x01
+#define   SX_CMD_READ_PRM           0x10
+#define   SX_REPLY_PRM_VALUE        0x11
+#define   SX_CMD_WRITE_PRM          0x12
+#define   SX_CMD_COMMIT_PRM         0x13
+#define   SX_CMD_READ_ALL_PRM       0x14
+#define   SX_CMD_MERGE_WAIT         0x15
+#define   SX_CMD_RAM_REPORT         0x16
+#define   SX_CMD_DEVICE_REPORT      0x17
+#define   SX_REPLY_COMMIT_PRM       0x33
+#define   SX_REPLY_MERGE_WAIT       0x35
+
+#define   MIDI_RX_CHANNEL           0       //  ch.1
+#define   RPN_COARSE_TUNE           0x0002
+#define   NRPN_PRM_MSB              SYSEX_ID_NONCOMMERCIAL
+#define   MIDI_CLOCK_PER_BEAT       24
+
+/*----------------------------------------------------------------------------*/
+//
+//     Receive one byte
+//
+/*----------------------------------------------------------------------------*/
+void MidiReceiver::receive( uint8_t dt )
+{
+  //  Realtime Message
+  if ( dt >= 0xf8 ){
+#ifdef USE_MIDI_MERGE
+    //  may be inserted anywhere, even in other message
+    setMidiRealtime(dt);
+#endif
+    if ( dt == 0xfa ){ _clockCount = 0;}   //  Start
+    else if ( dt == 0xf8 ){
+      if ( _clockCount == 0 ){ _mf.clockBeat();}
+      if ( ++_clockCount >= MIDI_CLOCK_PER_BEAT ){ _clockCount = 0;}
+    }
+    return;
+  }
+
+  if ( dt == 0xf0 ){
+    _inSysEx = true;
+    _sysExLength = 0;
+    return;
+  }
+
+  if ( _inSysEx == true ){
+    if ( dt == 0xf7 ){
+      _inSysEx = false;
+      if ( _sysExLength <= SYSEX_BUF_MAX ){ analyseSysEx();}
+      return;
+    }
+    else if ( dt & 0x80 ){
+      //  SysEx is broken
+      _inSysEx = false;
+    }
+    else {
+      if ( _sysExLength < SYSEX_BUF_MAX ){ _sysEx[_sysExLength] = dt;}
+      if ( _sysExLength <= SYSEX_BUF_MAX ){ _sysExLength++;}  //  SYSEX_BUF_MAX+1 means too long
+      return;
+    }
+  }
+
+  //  Channel Message
+  if ( dt & 0x80 ){
+    //  System Common cancels running status
+    _status = ( dt < 0xf0 )? dt:0;
+    _dataCount = 0;
+    return;
+  }
+  if ( _status == 0 ){ return;}
+
+  _data[_dataCount++] = dt;
+  const uint8_t length = (( _status & 0xe0 ) == 0xc0 )? 1:2;   //  Cn,Dn: 1byte
+  if ( _dataCount >= length ){
+    analyseChannelMessage();
+    _dataCount = 0;
+  }
+}
+/*----------------------------------------------------------------------------*/
+void MidiReceiver::analyseChannelMessage( void )
+{
+#ifdef USE_MIDI_MERGE
+  //  sent as a whole message after the lead note of own, so
+  //  running status of the output is never broken
+  const uint8_t ch = (_status + prm(PRM_MERGE_CH_SHIFT)) & 0x0f;
+  const uint8_t dt2 = (( _status & 0xe0 ) == 0xc0 )? 0xff:_data[1];
+  setMidiBufferLowPriority( (_status & 0xf0) | ch, _data[0], dt2 );
+#else
+  if (( _status & 0x0f ) != MIDI_RX_CHANNEL ){ return;}
+
+  switch ( _status & 0xf0 ){
+    case 0xc0: _mf.setTone(_data[0]); break;
+    case 0xb0: controlChange(_data[0], _data[1]); break;
+    default: break;
+  }
+#endif
+}
+/*----------------------------------------------------------------------------*/
+void MidiReceiver::controlChange( uint8_t number, uint8_t value )
+{
+  switch ( number ){
+    case 101: _prmNumMsb = value; _isRpn = true; break;
+    case 100: _prmNumLsb = value; _isRpn = true; break;
+    case  99: _prmNumMsb = value; _isRpn = false; break;
+    case  98: _prmNumLsb = value; _isRpn = false; break;
+    case   6: _dataMsb = value; if ( _isRpn == true ){ dataEntry(0);} break;
+    case  38: dataEntry(value); break;
+    default: break;
+  }
+}
+/*----------------------------------------------------------------------------*/
+void MidiReceiver::dataEntry( uint8_t lsb )
+{
+  const uint16_t prmNum = (static_cast<uint16_t>(_prmNumMsb)<<7) | _prmNumLsb;
+
+  if ( _isRpn == true ){
+    if ( prmNum == RPN_COARSE_TUNE ){
+      _mf.setTranspose(static_cast<int>(_dataMsb) - 64);
+    }
+  }
+  else if ( _prmNumMsb == NRPN_PRM_MSB ){
+    //  CC6 only holds the MSB, written by CC38 with the whole 14bit value
+    parameter_set(_prmNumLsb, static_cast<int16_t>((static_cast<uint16_t>(_dataMsb)<<7) | lsb));
+  }
+}
+/*----------------------------------------------------------------------------*/
+void MidiReceiver::analyseSysEx( void )
+{
+  if (( _sysExLength < 2 ) || ( _sysEx[0] != SYSEX_ID_NONCOMMERCIAL )){ return;}
+
+  switch ( _sysEx[1] ){
+#ifdef USE_PROFILER
+    case SX_CMD_PROFILE_DUMP:
+      profiler_dump();
+      break;
+#endif
+    case SX_CMD_READ_PRM:
+      if ( _sysExLength < 3 ){ break;}
+      replyParameter(_sysEx[2]);
+      break;
+    case SX_CMD_WRITE_PRM:
+      if ( _sysExLength < 5 ){ break;}
+      parameter_set(_sysEx[2], static_cast<int16_t>((static_cast<uint16_t>(_sysEx[3])<<7) | _sysEx[4]));
+      replyParameter(_sysEx[2]);
+      break;
+    case SX_CMD_COMMIT_PRM: {
+      const uint8_t ack[2] = { SYSEX_ID_NONCOMMERCIAL, SX_REPLY_COMMIT_PRM };
+      parameter_commit();
+      setMidiSysEx(ack, 2);
+      break;
+    }
+    case SX_CMD_READ_ALL_PRM:
+      for ( uint8_t i=0; i<PRM_MAX; i++ ){ replyParameter(i);}
+      break;
+    case SX_CMD_MERGE_WAIT: {
+      const uint32_t wait = midiLowPriorityMaxWait();
+      const uint8_t buf[5] = { SYSEX_ID_NONCOMMERCIAL, SX_REPLY_MERGE_WAIT,
+                               static_cast<uint8_t>((wait>>14) & 0x7f),
+                               static_cast<uint8_t>((wait>>7) & 0x7f),
+                               static_cast<uint8_t>(wait & 0x7f) };
+      setMidiSysEx(buf, 5);
+      break;
+    }
+    case SX_CMD_RAM_REPORT:
+      ram_monitor_report();
+      break;
+    case SX_CMD_DEVICE_REPORT:
+      _mf.reportDevices();
+      break;
+    default: break;
+  }
+}
+/*----------------------------------------------------------------------------*/
+void MidiReceiver::replyParameter( uint8_t id )
+{
+  if ( id >= PRM_MAX ){ return;}
+
+  const uint16_t value = static_cast<uint16_t>(prm(id));
+  uint8_t buf[5];
+  buf[0] = SYSEX_ID_NONCOMMERCIAL;
+  buf[1] = SX_REPLY_PRM_VALUE;
+  buf[2] = id;
+  buf[3] = static_cast<uint8_t>((value>>7) & 0x7f);
+  buf[4] = static_cast<uint8_t>(value & 0x7f);
+  setMidiSysEx(buf, 5);
+}
@@ -0,0 +1,73 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  midi_receiver.h
+ *    description: MIDI Input Parser
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#ifndef MIDI_RECEIVER_H
+#define MIDI_RECEIVER_H
+
+#include <Arduino.h>
+#include "magicflute.h"
+
+//  SysEx ( F0 7D cmd ... F7 )
+//    01              : request profile dump -> 21 id ... (each, see profiler.cpp)
+//    10 id           : read parameter  -> 11 id msb lsb
+//    12 id msb lsb   : write parameter -> 11 id msb lsb
+//    13              : commit parameters to EEPROM -> 33
+//    14              : read all parameters -> 11 id msb lsb (each)
+//    15              : read max wait of merged MIDI -> 35 usec(3byte, msb first)
+//    16              : read RAM usage -> 36 free minFree size... (see ram_monitor.cpp)
+//    17              : read device state -> 37 (id online errors overruns)... (see magicflute.cpp)
+//  Replies and trace frames ( 02 ) never use a command code, so a unit
+//  never takes SysEx of another unit merged on its input for a command.
+//  Such SysEx is ignored, not forwarded.
+//
+//  Channel Message is parsed with running status, and forwarded
+//  to own output in USE_MIDI_MERGE. Otherwise ch.1 controls MagicFlute
+//    Cn pgn          : tone (4-7: an octave lower)
+//    RPN 0/2 (CC6)   : transpose, 64 means 0
+//    NRPN 7D/id (CC6,CC38) : write parameter, when CC38 comes
+//  MIDI Clock flashes LED every beat.
+class MidiReceiver {
+
+public:
+  MidiReceiver( MagicFlute& mf ) : _mf(mf), _sysEx(), _sysExLength(0), _inSysEx(false),
+                         _status(0), _data(), _dataCount(0),
+                         _prmNumMsb(0x7f), _prmNumLsb(0x7f), _isRpn(true), _dataMsb(0),
+                         _clockCount(0) {}
+
+  void    receive( uint8_t dt );
+
+private:
+  void    analyseSysEx( void );
+  void    analyseChannelMessage( void );
+  void    controlChange( uint8_t number, uint8_t value );
+  void    dataEntry( uint8_t lsb );
+  void    replyParameter( uint8_t id );
+
+  static const uint8_t SYSEX_BUF_MAX = 8;
+
+  MagicFlute&   _mf;
+
+  uint8_t   _sysEx[SYSEX_BUF_MAX];
+  uint8_t   _sysExLength;
+  bool      _inSysEx;
+
+  uint8_t   _status;      //  running status, 0: none
+  uint8_t   _data[2];
+  uint8_t   _dataCount;
+
+  uint8_t   _prmNumMsb;   //  RPN/NRPN number
+  uint8_t   _prmNumLsb;
+  bool      _isRpn;
+  uint8_t   _dataMsb;
+
+  uint8_t   _clockCount;  //  0-23
+};
+#endif
@@ -0,0 +1,99 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  motion.cpp
+ *    description: Motion Sensor Class
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#include "motion.h"
+#include "configuration.h"
+#include "i2cdevice.h"
+#include "trace.h"
+
+/*----------------------------------------------------------------------------*/
+//  1g = 16384
+const int Motion::AXIS_NUM = 3;
+const int Motion::TILT_AXIS = 1;          //  Y: front/back of the instrument
+const int Motion::LOW_PASS_SHIFT = 3;     //  time constant: 8*10msec
+const int Motion::SHAKE_AV_SHIFT = 3;
+const int Motion::SHAKE_SHIFT = 8;        //  0.5g shake -> 32
+const int Motion::SHAKE_DEPTH_MAX = 64;
+const int Motion::BEND_DEAD_ZONE = 1024;  //  about 3.5 degree
+const int Motion::BEND_RANGE = 8191;      //  about 30 degree for full bend
+
+/*----------------------------------------------------------------------------*/
+void Motion::init( void )
+{
+#ifdef USE_ADXL345
+  i2cErrCode = 0;
+  adxl345_init(0);
+  if ( i2cErrCode != 0 ){ _health.goOffline();}
+#endif
+}
+/*----------------------------------------------------------------------------*/
+//
+//     One burst read, and fixed point filters
+//
+/*----------------------------------------------------------------------------*/
+void Motion::update( void )
+{
+#ifdef USE_ADXL345
+  signed short acc[3];
+  if ( _health.online() == false ){
+    if ( _health.retryNow() == true ){
+      i2cErrCode = 0;
+      adxl345_init(0);
+      if ( i2cErrCode != 0 ){ _health.retryFailed();}
+      else { _health.recovered();}
+    }
+    return;
+  }
+  if ( adxl345_getAccel(0, acc) != 0 ){ _health.fail(); return;}    //  keep last state
+  _health.succeed();
+  TRACE_MOTION(acc);
+
+  if ( _valid == false ){
+    //  first sample
+    for ( int i=0; i<AXIS_NUM; i++ ){ _lowPass[i] = acc[i];}
+    _tilt = _reference = acc[TILT_AXIS];
+    _valid = true;
+    return;
+  }
+
+  int32_t highPass = 0;
+  for ( int i=0; i<AXIS_NUM; i++ ){
+    int32_t diff = static_cast<int32_t>(acc[i]) - _lowPass[i];
+    _lowPass[i] += static_cast<int16_t>(diff >> LOW_PASS_SHIFT);
+    highPass += ( diff < 0 )? -diff:diff;
+  }
+  if ( highPass > 0xffff ){ highPass = 0xffff;}
+
+  _tilt = _lowPass[TILT_AXIS];
+  _shake += static_cast<int16_t>((highPass - _shake) >> SHAKE_AV_SHIFT);
+#endif
+}
+/*----------------------------------------------------------------------------*/
+uint16_t Motion::pitchBend( void ) const
+{
+  int32_t offset = static_cast<int32_t>(_tilt) - _reference;
+
+  if ( offset > BEND_DEAD_ZONE ){ offset -= BEND_DEAD_ZONE;}
+  else if ( offset < -BEND_DEAD_ZONE ){ offset += BEND_DEAD_ZONE;}
+  else { offset = 0;}
+
+  if ( offset > BEND_RANGE ){ offset = BEND_RANGE;}
+  else if ( offset < -BEND_RANGE ){ offset = -BEND_RANGE;}
+
+  return static_cast<uint16_t>(0x2000 + offset);
+}
+/*----------------------------------------------------------------------------*/
+uint8_t Motion::shakeDepth( void ) const
+{
+  uint16_t depth = _shake >> SHAKE_SHIFT;
+  if ( depth > SHAKE_DEPTH_MAX ){ depth = SHAKE_DEPTH_MAX;}
+  return static_cast<uint8_t>(depth);
+}
@@ -0,0 +1,50 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  motion.h
+ *    description: Motion Sensor Class
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#ifndef MOTION_H
+#define MOTION_H
+
+#include <Arduino.h>
+#include "device.h"
+
+//  ADXL345 as expression source ( called every 10msec )
+//    tilt from the posture at attack -> Pitch Bend
+//    shake -> Modulation depth
+class Motion {
+
+public:
+  Motion( void ) : _lowPass(), _tilt(0), _reference(0), _shake(0), _valid(false), _health() {}
+
+  void      init( void );
+  void      update( void );
+  void      setReference( void ){ _reference = _tilt;}
+  uint16_t  pitchBend( void ) const;                //  0 - 0x3fff, center 0x2000
+  uint8_t   shakeDepth( void ) const;               //  0 - SHAKE_DEPTH_MAX
+  const DeviceHealth& health( void ) const { return _health;}
+
+private:
+  static const int AXIS_NUM;
+  static const int TILT_AXIS;
+  static const int LOW_PASS_SHIFT;
+  static const int SHAKE_AV_SHIFT;
+  static const int SHAKE_SHIFT;
+  static const int SHAKE_DEPTH_MAX;
+  static const int BEND_DEAD_ZONE;
+  static const int BEND_RANGE;
+
+  int16_t   _lowPass[3];  //  each axis
+  int16_t   _tilt;
+  int16_t   _reference;
+  uint16_t  _shake;       //  mean of high pass
+  bool      _valid;
+  DeviceHealth  _health;  //  offline: the last state is kept, re-initialized
+};
+#endif
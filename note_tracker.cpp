@@ -0,0 +1,88 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  note_tracker.cpp
+ *    description: Sounding Note State
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#include "note_tracker.h"
+#include "TouchMIDI_AVR_if.h"
+
+/*----------------------------------------------------------------------------*/
+void NoteTracker::noteOn( uint8_t ch, uint8_t note, uint8_t vel, bool lowPriority )
+{
+  if (( ch >= CH_MAX ) || ( note > 127 )){ return;}
+
+  //  same note again: release first not to leave double Note On
+  if ( isSounding(ch, note) == true ){
+    send( 0x80|ch, note, 0x40, lowPriority );
+  }
+  _noteMap[ch][note>>3] |= static_cast<uint8_t>(1<<(note&0x07));
+  _dirty |= static_cast<uint8_t>(1<<ch);
+  if ( lowPriority == true ){ _lowPriority |= static_cast<uint8_t>(1<<ch);}
+  else { _lowPriority &= static_cast<uint8_t>(~(1<<ch));}
+  send( 0x90|ch, note, vel, lowPriority );
+}
+/*----------------------------------------------------------------------------*/
+void NoteTracker::noteOff( uint8_t ch, uint8_t note, bool lowPriority )
+{
+  if (( ch >= CH_MAX ) || ( note > 127 )){ return;}
+  if ( isSounding(ch, note) == false ){ return;}
+
+  _noteMap[ch][note>>3] &= static_cast<uint8_t>(~(1<<(note&0x07)));
+  send( 0x80|ch, note, 0x40, lowPriority );
+}
+/*----------------------------------------------------------------------------*/
+//
+//     Targeted Note Off for all sounding notes of the channel
+//
+/*----------------------------------------------------------------------------*/
+void NoteTracker::releaseChannel( uint8_t ch, bool lowPriority )
+{
+  if ( ch >= CH_MAX ){ return;}
+
+  for ( uint8_t i=0; i<16; i++ ){
+    if ( _noteMap[ch][i] == 0 ){ continue;}
+    for ( uint8_t j=0; j<8; j++ ){
+      if ( _noteMap[ch][i] & (1<<j) ){
+        send( 0x80|ch, (i<<3)|j, 0x40, lowPriority );
+      }
+    }
+    _noteMap[ch][i] = 0;
+  }
+}
+/*----------------------------------------------------------------------------*/
+bool NoteTracker::isSilent( uint8_t ch ) const
+{
+  for ( uint8_t i=0; i<16; i++ ){
+    if ( _noteMap[ch][i] != 0 ){ return false;}
+  }
+  return true;
+}
+/*----------------------------------------------------------------------------*/
+//
+//     Call periodically (1sec)
+//        All Note Off once for the channel which became silent
+//        by the path of its notes: a queued one is sent in order,
+//        and the lead one goes before any later Note On
+//
+/*----------------------------------------------------------------------------*/
+void NoteTracker::refresh( void )
+{
+  for ( uint8_t ch=0; ch<CH_MAX; ch++ ){
+    if (( _dirty & (1<<ch) ) && ( isSilent(ch) == true )){
+      send( 0xb0|ch, 0x7b, 0, ( _lowPriority & (1<<ch) ) != 0 );
+      _dirty &= static_cast<uint8_t>(~(1<<ch));
+    }
+  }
+}
+/*----------------------------------------------------------------------------*/
+void NoteTracker::send( uint8_t dt0, uint8_t dt1, uint8_t dt2, bool lowPriority )
+{
+  if ( lowPriority == true ){ setMidiBufferLowPriority( dt0, dt1, dt2 );}
+  else { setMidiBuffer( dt0, dt1, dt2 );}
+}
@@ -0,0 +1,45 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  note_tracker.h
+ *    description: Sounding Note State
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#ifndef NOTE_TRACKER_H
+#define NOTE_TRACKER_H
+
+#include <Arduino.h>
+
+//  Every Note On/Off goes through this class, and the sounding notes
+//  are kept as 128bit map for each channel.
+//  Note Off is sent for exactly the sounding pitch, and All Note Off
+//  is sent once when a used channel gets silent, to recover the receiver
+//  from a lost byte within refresh interval. It takes the same priority
+//  as the notes of the channel, so it never passes a later Note On.
+class NoteTracker {
+
+public:
+  static const uint8_t CH_MAX = 4;    //  lead + harmony voices
+
+  NoteTracker( void ) : _noteMap(), _dirty(0), _lowPriority(0) {}
+
+  void    noteOn( uint8_t ch, uint8_t note, uint8_t vel, bool lowPriority=false );
+  void    noteOff( uint8_t ch, uint8_t note, bool lowPriority=false );
+  void    releaseChannel( uint8_t ch, bool lowPriority=false );
+  bool    isSounding( uint8_t ch, uint8_t note ) const
+          { return (_noteMap[ch][note>>3] & (1<<(note&0x07))) != 0;}
+  bool    isSilent( uint8_t ch ) const;
+  void    refresh( void );
+
+private:
+  static void send( uint8_t dt0, uint8_t dt1, uint8_t dt2, bool lowPriority );
+
+  uint8_t   _noteMap[CH_MAX][16];
+  uint8_t   _dirty;     //  bit for each channel used after last refresh
+  uint8_t   _lowPriority; //  bit for each channel sent by low priority queue
+};
+#endif
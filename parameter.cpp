@@ -0,0 +1,97 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  parameter.cpp
+ *    description: Adjustable Parameter Table
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#include <EEPROM.h>
+#include "parameter.h"
+#include "flash_table.h"
+
+//-------------------------------------------------------------------------
+//  EEPROM Layout
+//    0: mark, 1: PRM_MAX, 2-: value(little endian), last: sum
+#define   PRM_EEPROM_TOP      0
+#define   PRM_EEPROM_MARK     0xa5
+
+//-------------------------------------------------------------------------
+struct ParameterRange {
+  int16_t   dflt;
+  int16_t   min;
+  int16_t   max;
+};
+
+static const FlashTable<ParameterRange,PRM_MAX> prmRange PROGMEM = {{
+  {  6,  1,   50 },   //  DEADBAND_POINT_TIME
+  {  5,  1,  100 },   //  MUTE_TIME
+  { 80,  0, 1000 },   //  ZERO_OFFSET
+  {  8,  1,  127 },   //  MIDI_EXP_ITP_STEP
+  { 20,  1, 1000 },   //  STABLE_COUNT
+  { 50,  1,  500 },   //  NOISE_WIDTH
+  {  4,  0,   15 },   //  MERGE_CH_SHIFT
+}};
+
+int16_t prmTable[PRM_MAX];
+
+/*----------------------------------------------------------------------------*/
+//
+//     Load from EEPROM, or default value
+//
+/*----------------------------------------------------------------------------*/
+void parameter_init( void )
+{
+  for ( int i=0; i<PRM_MAX; i++ ){
+    prmTable[i] = prmRange[i].dflt;
+  }
+
+  if ( EEPROM.read(PRM_EEPROM_TOP) != PRM_EEPROM_MARK ){ return;}
+  if ( EEPROM.read(PRM_EEPROM_TOP+1) != PRM_MAX ){ return;}
+
+  int16_t value[PRM_MAX];
+  uint8_t sum = 0;
+  for ( int i=0; i<PRM_MAX; i++ ){
+    uint8_t lsb = EEPROM.read(PRM_EEPROM_TOP+2+i*2);
+    uint8_t msb = EEPROM.read(PRM_EEPROM_TOP+3+i*2);
+    sum += lsb + msb;
+    value[i] = static_cast<int16_t>(lsb | (static_cast<uint16_t>(msb)<<8));
+  }
+  if ( EEPROM.read(PRM_EEPROM_TOP+2+PRM_MAX*2) != sum ){ return;}
+
+  for ( int i=0; i<PRM_MAX; i++ ){
+    parameter_set(i, value[i]);
+  }
+}
+/*----------------------------------------------------------------------------*/
+bool parameter_set( uint8_t id, int16_t value )
+{
+  if ( id >= PRM_MAX ){ return false;}
+  if (( value < prmRange[id].min ) || ( value > prmRange[id].max )){ return false;}
+  prmTable[id] = value;
+  return true;
+}
+/*----------------------------------------------------------------------------*/
+//
+//     Write to EEPROM
+//        blocking: about 3.3msec per changed byte, call when not playing
+//
+/*----------------------------------------------------------------------------*/
+void parameter_commit( void )
+{
+  uint8_t sum = 0;
+
+  EEPROM.update(PRM_EEPROM_TOP, PRM_EEPROM_MARK);
+  EEPROM.update(PRM_EEPROM_TOP+1, PRM_MAX);
+  for ( int i=0; i<PRM_MAX; i++ ){
+    uint8_t lsb = static_cast<uint8_t>(prmTable[i] & 0xff);
+    uint8_t msb = static_cast<uint8_t>((prmTable[i]>>8) & 0xff);
+    EEPROM.update(PRM_EEPROM_TOP+2+i*2, lsb);
+    EEPROM.update(PRM_EEPROM_TOP+3+i*2, msb);
+    sum += lsb + msb;
+  }
+  EEPROM.update(PRM_EEPROM_TOP+2+PRM_MAX*2, sum);
+}
@@ -0,0 +1,38 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  parameter.h
+ *    description: Adjustable Parameter Table
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#ifndef PARAMETER_H
+#define PARAMETER_H
+
+#include <Arduino.h>
+
+//  Parameter ID (also used in SysEx)
+enum {
+  PRM_DEADBAND_POINT_TIME,  //  ×10[msec]
+  PRM_MUTE_TIME,            //  ×100[msec]
+  PRM_ZERO_OFFSET,          //  raw sensor count
+  PRM_MIDI_EXP_ITP_STEP,    //  max 7bit value per 10msec
+  PRM_STABLE_COUNT,         //  ×10[msec]
+  PRM_NOISE_WIDTH,          //  raw sensor count
+  PRM_MERGE_CH_SHIFT,       //  channel shift of merged MIDI
+  PRM_MAX
+};
+
+extern int16_t prmTable[PRM_MAX];
+
+//  id is a constant on hot path, so this becomes a single RAM load
+inline int16_t prm( uint8_t id ){ return prmTable[id];}
+
+void parameter_init( void );
+bool parameter_set( uint8_t id, int16_t value );
+void parameter_commit( void );
+
+#endif
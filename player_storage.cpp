@@ -0,0 +1,114 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  player_storage.cpp
+ *    description: Player State in EEPROM
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#include <EEPROM.h>
+#include "player_storage.h"
+
+#ifdef __AVR__
+  #include <avr/eeprom.h>
+#endif
+
+/*----------------------------------------------------------------------------*/
+//
+//     Find the newest slot
+//
+/*----------------------------------------------------------------------------*/
+bool PlayerStorage::load( int8_t& toneNumber, int8_t& transpose, int& standardPressure )
+{
+  uint8_t rec[RECORD_SIZE];
+  int     newest = -1;
+  uint8_t newestSeq = 0;
+
+  for ( int i=0; i<SLOT_MAX; i++ ){
+    for ( int j=0; j<RECORD_SIZE; j++ ){
+      rec[j] = EEPROM.read(EEPROM_TOP + i*RECORD_SIZE + j);
+    }
+    if ( rec[RECORD_SIZE-1] != checkSum(rec) ){ continue;}
+
+    //  sequence numbers of all slots are within SLOT_MAX, so wrap around is ok
+    if (( newest < 0 ) || ( static_cast<int8_t>(rec[0] - newestSeq) > 0 )){
+      newest = i;
+      newestSeq = rec[0];
+      _toneNumber = static_cast<int8_t>(rec[1]);
+      _transpose = static_cast<int8_t>(rec[2]);
+      _standardPressure = static_cast<int>(rec[3] | (static_cast<uint16_t>(rec[4])<<8));
+    }
+  }
+  if ( newest < 0 ){ return false;}
+
+  _seq = newestSeq + 1;
+  _nextSlot = static_cast<uint8_t>((newest + 1) % SLOT_MAX);
+  toneNumber = _toneNumber;
+  transpose = _transpose;
+  standardPressure = _standardPressure;
+  return true;
+}
+/*----------------------------------------------------------------------------*/
+void PlayerStorage::save( int8_t toneNumber, int8_t transpose, int standardPressure )
+{
+  _toneNumber = toneNumber;
+  _transpose = transpose;
+  _standardPressure = standardPressure;
+
+  if ( _wrIndex < RECORD_SIZE ){
+    //  write the latest value after the current one
+    _pending = true;
+    return;
+  }
+  startWriting();
+}
+/*----------------------------------------------------------------------------*/
+//
+//     Call every 10msec
+//
+/*----------------------------------------------------------------------------*/
+void PlayerStorage::periodic( void )
+{
+  if ( _wrIndex >= RECORD_SIZE ){
+    if ( _pending == true ){
+      _pending = false;
+      startWriting();
+    }
+    return;
+  }
+
+#ifdef __AVR__
+  //  previous byte is still being written
+  if ( !eeprom_is_ready() ){ return;}
+#endif
+
+  //  check sum is written at last, so a broken record is never chosen
+  EEPROM.update(EEPROM_TOP + _nextSlot*RECORD_SIZE + _wrIndex, _record[_wrIndex]);
+  if ( ++_wrIndex >= RECORD_SIZE ){
+    _seq++;
+    _nextSlot = static_cast<uint8_t>((_nextSlot + 1) % SLOT_MAX);
+  }
+}
+/*----------------------------------------------------------------------------*/
+void PlayerStorage::startWriting( void )
+{
+  _record[0] = _seq;
+  _record[1] = static_cast<uint8_t>(_toneNumber);
+  _record[2] = static_cast<uint8_t>(_transpose);
+  _record[3] = static_cast<uint8_t>(_standardPressure & 0xff);
+  _record[4] = static_cast<uint8_t>((_standardPressure >> 8) & 0xff);
+  _record[5] = checkSum(_record);
+  _wrIndex = 0;
+}
+/*----------------------------------------------------------------------------*/
+uint8_t PlayerStorage::checkSum( const uint8_t* record )
+{
+  uint8_t sum = 0x5a;   //  all 0xff (erased) never matches
+  for ( int i=0; i<RECORD_SIZE-1; i++ ){
+    sum += record[i];
+  }
+  return sum;
+}
@@ -0,0 +1,49 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  player_storage.h
+ *    description: Player State in EEPROM
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#ifndef PLAYER_STORAGE_H
+#define PLAYER_STORAGE_H
+
+#include <Arduino.h>
+
+//  Player state is written to a ring of slots in EEPROM to spread wear.
+//  The newest slot has the largest sequence number.
+//  Writing is done one byte per call of periodic(), so never blocks.
+class PlayerStorage {
+
+public:
+  PlayerStorage( void ) : _seq(0), _nextSlot(0), _wrIndex(RECORD_SIZE), _pending(false),
+                          _toneNumber(0), _transpose(0), _standardPressure(0), _record() {}
+
+  bool    load( int8_t& toneNumber, int8_t& transpose, int& standardPressure );
+  void    save( int8_t toneNumber, int8_t transpose, int standardPressure );
+  void    periodic( void );
+  bool    busy( void ) const { return (_wrIndex < RECORD_SIZE) || _pending;}
+
+private:
+  void    startWriting( void );
+  static uint8_t  checkSum( const uint8_t* record );
+
+  static const int EEPROM_TOP = 32;     //  0-31 : parameter.cpp
+  static const int RECORD_SIZE = 6;     //  seq, tone, transpose, prs(L), prs(H), sum
+  static const int SLOT_MAX = 16;
+
+  uint8_t   _seq;
+  uint8_t   _nextSlot;
+  uint8_t   _wrIndex;
+  bool      _pending;
+
+  int8_t    _toneNumber;
+  int8_t    _transpose;
+  int       _standardPressure;
+  uint8_t   _record[RECORD_SIZE];
+};
+#endif
@@ -0,0 +1,52 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  product.h
+ *    description: Product Descriptor
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#ifndef PRODUCT_H
+#define PRODUCT_H
+
+#include "configuration.h"
+#include "device.h"
+
+//  Devices of this product, chosen by configuration.h
+//  Application code uses only these types.
+#if defined(HOST_SIMULATION)
+//  simulated devices of test/host
+#include "host_device.h"
+typedef HostPressure    PressureDevice;
+typedef HostTouch       TouchDevice;
+typedef HostDisplay     DisplayDevice;
+#else
+
+#if defined(USE_AP4)
+typedef Ap4Pressure     PressureDevice;
+#elif defined(USE_LPS22HB)
+typedef Lps22hbPressure PressureDevice;
+#elif defined(USE_LPS25H)
+typedef Lps25hPressure  PressureDevice;
+#else
+typedef AnalogPressure  PressureDevice;
+#endif
+
+#if defined(USE_CY8CMBR3110)
+typedef Mbr3110Touch    TouchDevice;
+#else
+typedef NoTouch         TouchDevice;
+#endif
+
+#if defined(USE_ADA88)
+typedef Ada88Display    DisplayDevice;
+#else
+typedef NoDisplay       DisplayDevice;
+#endif
+
+#endif
+
+#endif
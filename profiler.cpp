@@ -0,0 +1,96 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  profiler.cpp
+ *    description: Execution Time Profiler
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#include "profiler.h"
+#include "TouchMIDI_AVR_if.h"
+
+#ifdef USE_PROFILER
+ProfileStat profStat[PROF_MAX];
+
+/*----------------------------------------------------------------------------*/
+//
+//     Timer1 runs free at 2MHz (0.5us, wraps at 32.7msec)
+//
+/*----------------------------------------------------------------------------*/
+void profiler_init( void )
+{
+#ifdef __AVR__
+  TCCR1A = 0;
+  TCCR1B = _BV(CS11);   //  clk/8
+#endif
+  profiler_clear();
+}
+/*----------------------------------------------------------------------------*/
+void profiler_clear( void )
+{
+  for ( int i=0; i<PROF_MAX; i++ ){
+    profStat[i].min = 0xffff;
+    profStat[i].max = 0;
+    profStat[i].count = 0;
+    profStat[i].sum = 0;
+    for ( int j=0; j<PROF_HIST_NUM; j++ ){ profStat[i].hist[j] = 0;}
+  }
+}
+/*----------------------------------------------------------------------------*/
+void profiler_record( uint8_t id, uint16_t time )
+{
+  ProfileStat& st = profStat[id];
+
+  if ( st.count == 0xffff ){ return;}
+  st.count++;
+  st.sum += time;
+  if ( time < st.min ){ st.min = time;}
+  if ( time > st.max ){ st.max = time;}
+
+  //  log2 histogram from 16us(32 counts)
+  uint8_t bin = 0;
+  uint16_t tm = time >> 5;
+  while (( tm != 0 ) && ( bin < PROF_HIST_NUM-1 )){
+    tm >>= 1;
+    bin++;
+  }
+  if ( st.hist[bin] < 0x7f ){ st.hist[bin]++;}
+}
+/*----------------------------------------------------------------------------*/
+//
+//     Send as SysEx, one message for each probe, then clear
+//        F0 7D 21 id min(3) max(3) mean(3) count(3) hist(8) F7
+//        each value is 14bit+ in 7bit bytes, MSB first, unit 0.5us
+//
+/*----------------------------------------------------------------------------*/
+static void setSevenBit( uint8_t* buf, uint16_t value )
+{
+  buf[0] = static_cast<uint8_t>((value >> 14) & 0x03);
+  buf[1] = static_cast<uint8_t>((value >> 7) & 0x7f);
+  buf[2] = static_cast<uint8_t>(value & 0x7f);
+}
+/*----------------------------------------------------------------------------*/
+void profiler_dump( void )
+{
+  uint8_t buf[3+3*4+PROF_HIST_NUM];
+
+  for ( int i=0; i<PROF_MAX; i++ ){
+    const ProfileStat& st = profStat[i];
+    const uint16_t mean = ( st.count != 0 )? static_cast<uint16_t>(st.sum/st.count):0;
+
+    buf[0] = 0x7d;    //  non-commercial
+    buf[1] = 0x21;    //  profile data
+    buf[2] = static_cast<uint8_t>(i);
+    setSevenBit(&buf[3], ( st.count != 0 )? st.min:0);
+    setSevenBit(&buf[6], st.max);
+    setSevenBit(&buf[9], mean);
+    setSevenBit(&buf[12], st.count);
+    for ( int j=0; j<PROF_HIST_NUM; j++ ){ buf[15+j] = st.hist[j];}
+    setMidiSysEx(buf, 15+PROF_HIST_NUM);
+  }
+  profiler_clear();
+}
+#endif
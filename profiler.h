@@ -0,0 +1,87 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  profiler.h
+ *    description: Execution Time Profiler
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+#include "configuration.h"
+
+//  Probe ID
+enum {
+  PROF_LOOP,
+  PROF_TOUCH,       //  MagicFlute::checkSixTouch()
+  PROF_BREATH,      //  MagicFlute::midiOutAirPressure()
+  PROF_PERIODIC,    //  MagicFlute::periodic100msec()
+  PROF_I2C,         //  every I2C transfer
+  PROF_TOUCH_SCAN,  //  all CY8CMBR3110 in one frame
+  PROF_MOTION,      //  Motion::update()
+  PROF_VIBRATO,     //  Vibrato::addSample()
+  PROF_MAX
+};
+
+#define PROF_HIST_NUM   8     //  <16us, <32us, ... , >=1ms
+
+struct ProfileStat {
+  uint16_t  start;    //  Timer1 count at begin (0.5us)
+  uint16_t  min;
+  uint16_t  max;
+  uint16_t  count;
+  uint32_t  sum;
+  uint8_t   hist[PROF_HIST_NUM];
+};
+
+#ifdef USE_PROFILER
+extern ProfileStat profStat[PROF_MAX];
+
+void profiler_init( void );
+void profiler_record( uint8_t id, uint16_t time );
+void profiler_dump( void );
+void profiler_clear( void );
+
+//  Timer1 at clk/8: 0.5us a count, not cycles. On host, 0.5us counts of
+//  the simulated clock, which only the simulated devices advance
+inline uint16_t profiler_count( void )
+{
+#ifdef __AVR__
+  return TCNT1;
+#else
+  return static_cast<uint16_t>(micros()*2);
+#endif
+}
+inline void profiler_begin( uint8_t id )
+{
+#if defined(__AVR__) && defined(PROFILER_GPIO_RED)
+  if ( id == PROFILER_GPIO_RED ){ PORTD |= _BV(6);}     //  RED_LED
+#endif
+#if defined(__AVR__) && defined(PROFILER_GPIO_GREEN)
+  if ( id == PROFILER_GPIO_GREEN ){ PORTD |= _BV(7);}   //  GREEN_LED
+#endif
+  profStat[id].start = profiler_count();
+}
+inline void profiler_end( uint8_t id )
+{
+  profiler_record(id, profiler_count() - profStat[id].start);
+#if defined(__AVR__) && defined(PROFILER_GPIO_RED)
+  if ( id == PROFILER_GPIO_RED ){ PORTD &= ~_BV(6);}
+#endif
+#if defined(__AVR__) && defined(PROFILER_GPIO_GREEN)
+  if ( id == PROFILER_GPIO_GREEN ){ PORTD &= ~_BV(7);}
+#endif
+}
+  #define PROF_BEGIN(id)    profiler_begin(id)
+  #define PROF_END(id)      profiler_end(id)
+#else
+  #define PROF_BEGIN(id)
+  #define PROF_END(id)
+#endif
+
+#endif
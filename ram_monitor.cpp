@@ -0,0 +1,169 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  ram_monitor.cpp
+ *    description: SRAM Budget & Stack Monitor
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#include "ram_monitor.h"
+#include "TouchMIDI_AVR_if.h"
+#include "configuration.h"
+#include "magicflute.h"
+#include "air_pressure.h"
+#include "note_tracker.h"
+#include "harmonizer.h"
+#include "player_storage.h"
+#include "midi_receiver.h"
+#include "parameter.h"
+#include "profiler.h"
+#include "motion.h"
+#include "trace.h"
+#include "product.h"
+#include "flash_table.h"
+
+#define RAM_CANARY    0xc5
+#define RAM_SIZE      2048    //  ATmega328P
+#define RAM_LIBRARY   256     //  HardwareSerial, Wire and NeoPixel buffers
+#define RAM_STACK_MIN 512     //  MBR3110_writeConfig() puts 129 byte on it
+
+//-------------------------------------------------------------------------
+//  Static RAM Budget [byte]
+//    checked at compile time for AVR ( int is 16bit )
+//    kept in flash, a constexpr array read at runtime goes to .data
+//    the statics of SAXduino.ino: timer, display and LED driver health
+constexpr uint16_t sketchRam = sizeof(GlobalTimer) + sizeof(DisplayDevice)
+#ifdef USE_PCA9685
+                             + sizeof(DeviceHealth)
+#endif
+                             ;
+struct RamBudget {
+  uint16_t  size;
+  uint16_t  budget;
+};
+
+constexpr FlashTable<RamBudget,RAM_MODULE_MAX> ramBudget PROGMEM = {{
+  { sizeof(MagicFlute),     56 },
+  { sizeof(AirPressure),   192 },
+  { sizeof(NoteTracker),    72 },
+  { sizeof(Harmonizer),      8 },
+  { sizeof(PlayerStorage),  16 },
+  { sizeof(MidiReceiver),   24 },
+  { sizeof(prmTable),       16 },
+#ifdef USE_PROFILER
+  { sizeof(profStat),      160 },
+#else
+  { 0,                     160 },
+#endif
+#ifdef USE_ADXL345
+  { sizeof(Motion),         24 },
+#else
+  { 0,                      24 },
+#endif
+  { MIDI_OUTPUT_RAM,       128 },
+#ifdef USE_TRACE_CAPTURE
+  { TRACE_RAM,              56 },
+#else
+  { 0,                      56 },
+#endif
+  { sketchRam,              48 },
+}};
+
+constexpr bool withinBudget( int id )
+{
+  return ( id >= RAM_MODULE_MAX ) ||
+         (( ramBudget._data[id].size <= ramBudget._data[id].budget ) && withinBudget(id+1));
+}
+constexpr uint16_t totalBudget( int id )
+{
+  return ( id >= RAM_MODULE_MAX )? 0:ramBudget._data[id].budget + totalBudget(id+1);
+}
+//  checked on host too: the budgets leave room for the libraries and stack,
+//  and the modules of fixed width types keep theirs ( int is 32bit on host )
+static_assert( totalBudget(0) <= RAM_SIZE - RAM_LIBRARY - RAM_STACK_MIN, "RAM budgets exceed the RAM" );
+static_assert(( MIDI_OUTPUT_RAM <= ramBudget._data[RAM_MIDI_OUTPUT].budget ) &&
+              ( TRACE_RAM <= ramBudget._data[RAM_TRACE].budget ), "a module exceeds its RAM budget" );
+
+#ifdef __AVR__
+static_assert( withinBudget(0), "a module exceeds its RAM budget" );
+
+//-------------------------------------------------------------------------
+extern uint8_t _end;
+extern uint8_t __stack;
+extern uint8_t __heap_start;
+extern void* __brkval;
+
+/*----------------------------------------------------------------------------*/
+//
+//     Paint RAM before .data/.bss are initialized
+//        r1 is not cleared yet, so written in asm
+//
+/*----------------------------------------------------------------------------*/
+void ram_monitor_paint( void ) __attribute__ ((naked, used, section(".init1")));
+void ram_monitor_paint( void )
+{
+  __asm volatile (
+    "ldi r30,lo8(_end)\n\t"
+    "ldi r31,hi8(_end)\n\t"
+    "ldi r24,%0\n\t"
+    "ldi r25,hi8(__stack)\n\t"
+    "rjmp 2f\n"
+    "1:\n\t"
+    "st Z+,r24\n"
+    "2:\n\t"
+    "cpi r30,lo8(__stack)\n\t"
+    "cpc r31,r25\n\t"
+    "brlo 1b\n\t"
+    "breq 1b"
+    :: "M" (RAM_CANARY) );
+}
+/*----------------------------------------------------------------------------*/
+static uint8_t* heapTop( void )
+{
+  return ( __brkval != 0 )? static_cast<uint8_t*>(__brkval):&__heap_start;
+}
+/*----------------------------------------------------------------------------*/
+uint16_t ram_monitor_free( void )
+{
+  uint8_t top;    //  on the stack
+  return static_cast<uint16_t>(&top - heapTop());
+}
+/*----------------------------------------------------------------------------*/
+uint16_t ram_monitor_minFree( void )
+{
+  const uint8_t* p = heapTop();
+  uint16_t count = 0;
+  while (( p <= &__stack ) && ( *p == RAM_CANARY )){ p++; count++;}
+  return count;
+}
+#else
+uint16_t ram_monitor_free( void ){ return 0;}
+uint16_t ram_monitor_minFree( void ){ return 0;}
+#endif
+/*----------------------------------------------------------------------------*/
+//
+//     Send as SysEx
+//        F0 7D 36 free(2) minFree(2) size(2)*RAM_MODULE_MAX F7
+//        each value is 14bit in 7bit bytes, MSB first
+//
+/*----------------------------------------------------------------------------*/
+void ram_monitor_report( void )
+{
+  uint8_t buf[2+2*2+2*RAM_MODULE_MAX];
+  uint16_t value[2+RAM_MODULE_MAX];
+
+  value[0] = ram_monitor_free();
+  value[1] = ram_monitor_minFree();
+  for ( int i=0; i<RAM_MODULE_MAX; i++ ){ value[2+i] = ramBudget[i].size;}
+
+  buf[0] = 0x7d;    //  non-commercial
+  buf[1] = 0x36;    //  RAM report
+  for ( int i=0; i<2+RAM_MODULE_MAX; i++ ){
+    buf[2+i*2] = static_cast<uint8_t>((value[i] >> 7) & 0x7f);
+    buf[3+i*2] = static_cast<uint8_t>(value[i] & 0x7f);
+  }
+  setMidiSysEx(buf, sizeof(buf));
+}
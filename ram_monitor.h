@@ -0,0 +1,40 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  ram_monitor.h
+ *    description: SRAM Budget & Stack Monitor
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#ifndef RAM_MONITOR_H
+#define RAM_MONITOR_H
+
+#include <Arduino.h>
+
+//  Module ID of RAM budget
+enum {
+  RAM_MAGIC_FLUTE,
+  RAM_AIR_PRESSURE,
+  RAM_NOTE_TRACKER,
+  RAM_HARMONIZER,
+  RAM_PLAYER_STORAGE,
+  RAM_MIDI_RECEIVER,
+  RAM_PARAMETER,
+  RAM_PROFILER,
+  RAM_MOTION,
+  RAM_MIDI_OUTPUT,
+  RAM_TRACE,
+  RAM_SKETCH,         //  statics of SAXduino.ino
+  RAM_MODULE_MAX
+};
+
+//  RAM between heap and stack is painted before startup, so the bytes
+//  never touched by stack tell the high-water mark.
+uint16_t ram_monitor_free( void );      //  now
+uint16_t ram_monitor_minFree( void );   //  since power on
+void ram_monitor_report( void );
+
+#endif
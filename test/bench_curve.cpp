@@ -0,0 +1,97 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  bench_curve.cpp
+ *    description: Cost of BreathCurve::exp14() ( host )
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#include <stdio.h>
+#include <time.h>
+#include "breath_curve.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+  #include <x86intrin.h>
+  #define HAS_TSC
+#endif
+
+//  Host time and TSC cycles of exp14(), against the former interpolation
+//  by a 32bit product. exp14() must give the same value for every input of
+//  every curve. On the target the split product is 16bit multiplies
+//  ( int is 16bit ), while the former one called the 32bit multiply.
+
+/*----------------------------------------------------------------------------*/
+#define   CALL_NUM      20000000UL
+
+static volatile uint16_t sink;
+
+//  the former interpolation, over the points read back from the curve
+static uint16_t reference( const uint16_t* point, uint16_t x )
+{
+  const uint8_t seg = static_cast<uint8_t>(x >> BreathCurve::SEG_BITS);
+  const uint8_t frac = static_cast<uint8_t>(x & ((1<<BreathCurve::SEG_BITS)-1));
+  const int16_t slope = static_cast<int16_t>(point[seg+1] - point[seg]);
+  return point[seg] + static_cast<int16_t>((static_cast<int32_t>(slope)*frac) >> BreathCurve::SEG_BITS);
+}
+
+/*----------------------------------------------------------------------------*/
+static double measure( const BreathCurve& bc, const uint16_t* point, bool ref, double* cycles )
+{
+  timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+#ifdef HAS_TSC
+  const unsigned long long tsc = __rdtsc();
+#endif
+  uint16_t acc = 0;
+  for ( unsigned long i=0; i<CALL_NUM; i++ ){
+    const uint16_t x = static_cast<uint16_t>((i*7) % BreathCurve::INPUT_SPAN);
+    acc += ref? reference(point, x):bc.exp14(x);
+  }
+#ifdef HAS_TSC
+  *cycles = static_cast<double>(__rdtsc() - tsc)/CALL_NUM;
+#else
+  *cycles = 0;
+#endif
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  sink = acc;
+  return ((end.tv_sec - start.tv_sec)*1e9 + (end.tv_nsec - start.tv_nsec))/CALL_NUM;
+}
+
+/*----------------------------------------------------------------------------*/
+int main( void )
+{
+  static BreathCurve bc;
+  static const char* const name[] = { "log", "linear", "soft" };
+  int mismatch = 0;
+
+  for ( int c=BreathCurve::CURVE_LOG; c<BreathCurve::CURVE_PLAYER; c++ ){
+    bc.select(c);
+    //  the points, the last one by the slope of the end of the curve
+    uint16_t point[BreathCurve::SEG_NUM+1];
+    for ( int i=0; i<BreathCurve::SEG_NUM; i++ ){ point[i] = bc.exp14(i << BreathCurve::SEG_BITS);}
+    point[BreathCurve::SEG_NUM] = 0x3fff;
+
+    for ( uint16_t x=0; x<BreathCurve::INPUT_SPAN; x++ ){
+      if ( bc.exp14(x) != reference(point, x) ){
+        if ( mismatch++ < 10 ){ printf("MISMATCH %s x %u: %u %u\n", name[c], x, bc.exp14(x), reference(point, x));}
+      }
+    }
+
+    double cyc, refCyc;
+    const double ns = measure(bc, point, false, &cyc);
+    const double refNs = measure(bc, point, true, &refCyc);
+    printf("%-6s exp14(): %.2f nsec/call", name[c], ns);
+#ifdef HAS_TSC
+    printf(", %.1f TSC cycles", cyc);
+#endif
+    printf("  32bit product: %.2f nsec/call", refNs);
+#ifdef HAS_TSC
+    printf(", %.1f TSC cycles", refCyc);
+#endif
+    printf("\n");
+  }
+  return ( mismatch == 0 )? 0:1;
+}
@@ -0,0 +1,89 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  bench_pressure.cpp
+ *    description: Pressure Sensor Rate through the Whole Loop ( host )
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#include <stdio.h>
+#include "host_platform.h"
+
+//  Built once for each pressure sensor ( HOST_PRS_PERIOD_US, HOST_PRS_BURST )
+//  by Makefile. It reports I2C transfers and samples per second while idle
+//  and while playing, Note On latency from the start of a breath, and the
+//  velocity of the same attack, which must not depend on the sensor.
+
+/*----------------------------------------------------------------------------*/
+#define   STANDARD_PRS    2000
+#define   BREATH_PRS      1200
+#define   ATTACK_US       40000UL
+#define   MEASURE_US      2000000UL
+#define   PHASE_NUM       10
+
+/*----------------------------------------------------------------------------*/
+static void rate( const char* what, uint32_t us )
+{
+  const uint32_t read = hostPressureRead;
+  const uint32_t sample = hostPressureSample;
+  hostRun(us);
+  printf("  %-8s %6.0f transfers/sec, %6.0f samples/sec\n", what,
+         (hostPressureRead - read)*1e6/us, (hostPressureSample - sample)*1e6/us);
+}
+/*----------------------------------------------------------------------------*/
+static const HostMidi* attack( uint32_t phase, uint32_t& latency )
+{
+  hostPressure = STANDARD_PRS;
+  hostRun(2000000 + phase);
+
+  const size_t top = hostMidi.size();
+  const uint32_t start = hostMicros;
+  while ( hostMicros - start < MEASURE_US ){
+    const uint32_t t = hostMicros - start;
+    hostPressure = STANDARD_PRS + (( t < ATTACK_US )? static_cast<int>(BREATH_PRS*t/ATTACK_US):BREATH_PRS);
+    hostLoop();
+    for ( size_t i=top; i<hostMidi.size(); i++ ){
+      if ((( hostMidi[i].status & 0xf0 ) == 0x90 ) && ( hostMidi[i].data2 != 0 )){
+        latency = hostMidi[i].time - start;
+        return &hostMidi[i];
+      }
+    }
+  }
+  latency = MEASURE_US;
+  return 0;
+}
+/*----------------------------------------------------------------------------*/
+int main( void )
+{
+  printf("sample period %lu usec, burst %d\n", (unsigned long)HOST_PRS_PERIOD_US, HOST_PRS_BURST);
+  hostPressure = STANDARD_PRS;
+  hostSetup();
+  hostRun(2000000);
+  hostPressure = STANDARD_PRS + BREATH_PRS;
+  hostRun(300000);
+  hostPressure = STANDARD_PRS;
+  hostRun(2000000);     //  mute time has passed
+
+  rate("idle", MEASURE_US);
+  hostPressure = STANDARD_PRS + BREATH_PRS;
+  hostRun(200000);
+  rate("playing", MEASURE_US);
+
+  uint32_t sum = 0, max = 0;
+  int velMin = 127, velMax = 0;
+  for ( int i=0; i<PHASE_NUM; i++ ){
+    uint32_t latency = 0;
+    const HostMidi* on = attack(i*1000, latency);
+    if ( on == 0 ){ printf("  no Note On\n"); return 1;}
+    sum += latency;
+    if ( latency > max ){ max = latency;}
+    if ( on->data2 < velMin ){ velMin = on->data2;}
+    if ( on->data2 > velMax ){ velMax = on->data2;}
+  }
+  printf("  Note On %.1f msec average, %.1f msec max, velocity %d-%d\n",
+         sum/1000.0/PHASE_NUM, max/1000.0, velMin, velMax);
+  return 0;
+}
@@ -0,0 +1,56 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  bench_vibrato.cpp
+ *    description: Cost of Vibrato::addSample() ( host )
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#include <stdio.h>
+#include <time.h>
+#include "vibrato.h"
+#if defined(__x86_64__) || defined(__i386__)
+  #include <x86intrin.h>
+  #define HAS_TSC
+#endif
+
+//  Host time and TSC cycles per sample. On the target, PROF_VIBRATO of
+//  USE_PROFILER measures the same function in 0.5us counts of Timer1
+//  ( clk/8 ), so to 8 CPU cycles.
+
+/*----------------------------------------------------------------------------*/
+#define   SAMPLE_NUM    20000000UL
+
+int main( void )
+{
+  static Vibrato vb;
+  static int prs[400];
+  for ( int i=0; i<400; i++ ){
+    //  5Hz vibrato and 60Hz growl at 400Hz sampling ( one 1sec loop )
+    prs[i] = 3000 + ((i/40)&1? 30:-30) + ((i/3)&1? 8:-8);
+  }
+
+  timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+#ifdef HAS_TSC
+  const unsigned long long tsc = __rdtsc();
+#endif
+  for ( unsigned long i=0; i<SAMPLE_NUM; i++ ){
+    vb.addSample(prs[i%400], static_cast<uint16_t>((i*5)/2));
+  }
+#ifdef HAS_TSC
+  const double cycles = static_cast<double>(__rdtsc() - tsc)/SAMPLE_NUM;
+#endif
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  const double ns = ((end.tv_sec - start.tv_sec)*1e9 + (end.tv_nsec - start.tv_nsec))/SAMPLE_NUM;
+
+  printf("Vibrato::addSample(): %.2f nsec/sample", ns);
+#ifdef HAS_TSC
+  printf(", %.1f TSC cycles/sample", cycles);
+#endif
+  printf(" ( depth %d, growl %d )\n", vb.depth(), vb.growlDepth());
+  return 0;
+}
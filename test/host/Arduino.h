@@ -0,0 +1,44 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  Arduino.h
+ *    description: Arduino API for Host Simulation
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef uint8_t byte;
+
+#define HIGH          1
+#define LOW           0
+#define INPUT         0
+#define OUTPUT        1
+#define INPUT_PULLUP  2
+#define SDA           18
+#define SCL           19
+
+//  simulated clock, the 10msec timer interrupt is raised by hostAdvance()
+extern uint32_t hostMicros;
+void hostAdvance( uint32_t us );
+
+inline unsigned long micros( void ){ return hostMicros;}
+inline unsigned long millis( void ){ return hostMicros/1000;}
+inline void delay( unsigned long ms ){ hostAdvance(ms*1000);}
+inline void delayMicroseconds( unsigned int us ){ hostAdvance(us);}
+inline void noInterrupts( void ){}
+inline void interrupts( void ){}
+inline void pinMode( uint8_t, uint8_t ){}
+inline void digitalWrite( uint8_t, uint8_t ){}
+inline int  digitalRead( uint8_t ){ return HIGH;}
+inline int  analogRead( uint8_t ){ return 0;}
+
+#endif
@@ -0,0 +1,30 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  EEPROM.h
+ *    description: EEPROM for Host Simulation
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#ifndef HOST_EEPROM_H
+#define HOST_EEPROM_H
+
+#include <Arduino.h>
+
+class EEPROMClass {
+public:
+  EEPROMClass( void ){ memset(_mem, 0xff, sizeof(_mem));}
+  uint8_t   read( int adrs ) const { return _mem[adrs & (SIZE-1)];}
+  void      write( int adrs, uint8_t dt ){ _mem[adrs & (SIZE-1)] = dt;}
+  void      update( int adrs, uint8_t dt ){ write(adrs, dt);}
+  uint16_t  length( void ) const { return SIZE;}
+private:
+  static const int SIZE = 1024;
+  uint8_t   _mem[SIZE];
+};
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,118 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  host_device.h
+ *    description: Simulated Devices for Host Simulation
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#ifndef HOST_DEVICE_H
+#define HOST_DEVICE_H
+
+#include "device.h"
+
+//  Devices of product.h with HOST_SIMULATION. They read the values set
+//  by a test, take the I2C time of the real device and can fail.
+//    HOST_PRS_BURST 1      : read on demand, like AP4
+//    HOST_PRS_BURST n>1    : FIFO with HOST_PRS_PERIOD_US ODR, read by bursts of n
+#ifndef HOST_PRS_PERIOD_US
+  #define HOST_PRS_PERIOD_US  2500
+#endif
+#ifndef HOST_PRS_BURST
+  #define HOST_PRS_BURST    1
+#endif
+
+#define HOST_PRS_READ_US    200     //  I2C time at 400kHz, measured on Arduino
+#define HOST_TOUCH_SCAN_US  300
+#define HOST_MOTION_READ_US 250
+#define HOST_FIFO_DEPTH     32
+
+extern int      hostPressure;       //  raw 14bit count
+extern uint32_t hostKeys;           //  10 keys each chip
+extern bool     hostPressureFail;   //  every transfer fails while true
+extern bool     hostTouchFail;
+extern bool     hostMotionFail;
+extern bool     hostDisplayFail;
+extern uint32_t hostPressureRead;   //  transfers since power on
+extern uint32_t hostPressureSample; //  samples delivered since power on
+extern int      hostDisplayNumber;
+extern int16_t  hostAccel[3];       //  ADXL345, 1g = 16384
+
+//  called just before a device takes its value above, so a replay of a
+//  trace capture can set the value the device had at this time
+enum { HOST_IN_PRESSURE, HOST_IN_TOUCH, HOST_IN_MOTION };
+extern void   (*hostInputHook)( int in );
+inline void hostInput( int in ){ if ( hostInputHook != 0 ){ hostInputHook(in);}}
+
+/*----------------------------------------------------------------------------*/
+class HostPressure : public PressureSensor<HostPressure> {
+public:
+  HostPressure( void ) : _fifoTime(0) {}
+  static const uint8_t SAMPLE_MAX = HOST_PRS_BURST;
+  static const uint16_t SAMPLE_PERIOD_US = HOST_PRS_PERIOD_US;
+private:
+  friend class PressureSensor<HostPressure>;
+  int     initDevice( void ){ _fifoTime = hostMicros; return transfer();}
+  int     readDevice( void ){ int smpl = 0; readSamplesDevice(&smpl, 1); return smpl;}
+  uint8_t readSamplesDevice( int* buf, uint8_t max )
+          {
+            if ( transfer() != 0 ){ return 0;}
+            if ( SAMPLE_MAX == 1 ){
+              hostInput(HOST_IN_PRESSURE);
+              buf[0] = hostPressure; hostPressureSample++; return 1;
+            }
+
+            //  samples queued at ODR since the last read, the oldest are lost by overrun
+            const uint32_t period = SAMPLE_PERIOD_US;
+            if ( hostMicros - _fifoTime > HOST_FIFO_DEPTH*period ){
+              _fifoTime = hostMicros - HOST_FIFO_DEPTH*period;
+            }
+            uint8_t num = 0;
+            while (( num < max ) && ( hostMicros - _fifoTime >= period )){
+              _fifoTime += period;
+              hostInput(HOST_IN_PRESSURE);
+              buf[num++] = hostPressure;
+            }
+            hostPressureSample += num;
+            return num;
+          }
+  int     transfer( void )
+          {
+            hostAdvance(HOST_PRS_READ_US);
+            hostPressureRead++;
+            if ( hostPressureFail == true ){ i2cErrCode = 2;}
+            return hostPressureFail? 2:0;
+          }
+  uint32_t  _fifoTime;    //  usec of the last queued sample
+};
+
+/*----------------------------------------------------------------------------*/
+class HostTouch : public TouchSensor<HostTouch> {
+  friend class TouchSensor<HostTouch>;
+  int     initDevice( void ){ return hostTouchFail? 2:0;}
+  int     scanDevice( unsigned long* keys )
+          {
+            hostAdvance(HOST_TOUCH_SCAN_US);
+            if ( hostTouchFail == true ){ return 2;}
+            hostInput(HOST_IN_TOUCH);
+            *keys = hostKeys;
+            return 0;
+          }
+};
+
+/*----------------------------------------------------------------------------*/
+class HostDisplay : public Display<HostDisplay> {
+  friend class Display<HostDisplay>;
+  int     initDevice( void ){ return hostDisplayFail? 2:0;}
+  int     writeLetterDevice( int ){ return hostDisplayFail? 2:0;}
+  int     writeNumberDevice( int number )
+          {
+            if ( hostDisplayFail == true ){ return 2;}
+            hostDisplayNumber = number;
+            return 0;
+          }
+};
+#endif
@@ -0,0 +1,215 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  host_platform.cpp
+ *    description: Sketch Platform for Host Simulation
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#include "host_platform.h"
+#include <EEPROM.h>
+#include <deque>
+#include "configuration.h"
+#include "TouchMIDI_AVR_if.h"
+#include "i2cdevice.h"
+#include "parameter.h"
+#include "main_loop.h"
+#include "profiler.h"
+
+uint32_t      hostMicros = 0;
+EEPROMClass   EEPROM;
+GlobalTimer   gt;
+int           i2cErrCode = 0;
+
+int       hostPressure = 0;
+uint32_t  hostKeys = 0;
+bool      hostPressureFail = false;
+bool      hostTouchFail = false;
+bool      hostMotionFail = false;
+bool      hostDisplayFail = false;
+uint32_t  hostPressureRead = 0;
+uint32_t  hostPressureSample = 0;
+int       hostDisplayNumber = 0;
+int16_t   hostAccel[3] = { 0, 0, 16384 };
+void      (*hostInputHook)( int in ) = 0;
+std::vector<HostMidi> hostMidi;
+std::vector<HostSysEx> hostSysEx;
+std::vector<HostByte> hostTx;
+
+MagicFlute    hostFlute;
+MidiReceiver  hostMidiIn(hostFlute);
+
+static std::deque<HostByte> hostRx;
+
+/*----------------------------------------------------------------------------*/
+void hostAdvance( uint32_t us )
+{
+  const uint32_t before = hostMicros/10000;
+  hostMicros += us;
+  for ( uint32_t i=before; i<hostMicros/10000; i++ ){
+    gt.incGlobalTime();   //  MsTimer2
+  }
+}
+
+static DisplayDevice display;
+
+/*----------------------------------------------------------------------------*/
+//
+//     Serial TX of 31250bps
+//
+/*----------------------------------------------------------------------------*/
+#define   UART_TX_BUFFER    64      //  HardwareSerial of Arduino
+#define   UART_BYTE_US      320     //  10bit
+
+static uint32_t txEnd = 0;    //  when the last written byte leaves the wire
+
+static int txQueued( void )
+{
+  const int32_t busy = static_cast<int32_t>(txEnd - hostMicros);
+  return ( busy > 0 )? (busy + UART_BYTE_US - 1)/UART_BYTE_US:0;
+}
+/*----------------------------------------------------------------------------*/
+//  receiver side, messages stamped when their last byte arrives
+static void parseTx( uint8_t dt, uint32_t time )
+{
+  static uint8_t  status = 0;
+  static uint8_t  data[2];
+  static uint8_t  count = 0;
+  static bool     inSysEx = false;
+
+  if ( dt >= 0xf8 ){
+    HostMidi msg = { time, dt, 0xff, 0xff };
+    hostMidi.push_back(msg);
+    return;
+  }
+  if ( dt == 0xf0 ){
+    HostSysEx sx = { time, std::vector<uint8_t>() };
+    hostSysEx.push_back(sx);
+    inSysEx = true;
+    status = 0;
+    return;
+  }
+  if ( inSysEx == true ){
+    if (( dt & 0x80 ) == 0 ){ hostSysEx.back().data.push_back(dt); return;}
+    inSysEx = false;
+    hostSysEx.back().time = time;
+  }
+  if ( dt & 0x80 ){
+    status = ( dt < 0xf0 )? dt:0;
+    count = 0;
+    return;
+  }
+  if ( status == 0 ){ return;}
+
+  data[count++] = dt;
+  const uint8_t length = (( status & 0xe0 ) == 0xc0 )? 1:2;
+  if ( count >= length ){
+    HostMidi msg = { time, status, data[0], ( length == 2 )? data[1]:static_cast<uint8_t>(0xff) };
+    hostMidi.push_back(msg);
+    count = 0;
+  }
+}
+/*----------------------------------------------------------------------------*/
+void midiTxWrite( uint8_t dt )
+{
+  //  blocks until the buffer has room
+  const int32_t wait = static_cast<int32_t>(txEnd - (UART_TX_BUFFER - 1)*UART_BYTE_US - hostMicros);
+  if ( wait > 0 ){ hostAdvance(wait);}
+
+  txEnd = (( txQueued() > 0 )? txEnd:hostMicros) + UART_BYTE_US;
+  HostByte tx = { txEnd, dt };
+  hostTx.push_back(tx);
+  parseTx(dt, txEnd);
+}
+int midiTxRoom( void )
+{
+  return UART_TX_BUFFER - txQueued();
+}
+
+/*----------------------------------------------------------------------------*/
+//
+//     Drivers ( devices are in host_device.h )
+//
+/*----------------------------------------------------------------------------*/
+int i2c_recoverBus( void ){ return 0;}
+void adxl345_init( unsigned char )
+{
+  if ( hostMotionFail == true ){ i2cErrCode = 2;}
+}
+int adxl345_getAccel( unsigned char, signed short* value )
+{
+  hostAdvance(HOST_MOTION_READ_US);
+  if ( hostMotionFail == true ){ i2cErrCode = 2; return 2;}
+  hostInput(HOST_IN_MOTION);
+  for ( int i=0; i<3; i++ ){ value[i] = hostAccel[i];}
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+//
+//     TouchMIDI_AVR_if.h
+//
+/*----------------------------------------------------------------------------*/
+int analogDataRead( void ){ return 0;}
+int midiRxRead( void )
+{
+  if (( hostRx.empty() == true ) || ( static_cast<int32_t>(hostRx.front().time - hostMicros) > 0 )){
+    return -1;
+  }
+  const uint8_t dt = hostRx.front().dt;
+  hostRx.pop_front();
+  return dt;
+}
+void idleSleep( void )
+{
+  //  wakes up by Timer0 ( 1msec )
+  hostAdvance(1000 - hostMicros%1000);
+}
+void displayError( void ){}
+void indicateAlive( bool ){}
+void setAda88_Number( int number ){ display.writeNumber(number);}
+void setMute( bool ){}
+uint8_t colorTbl( uint8_t, uint8_t ){ return 0;}
+void setLed( int, uint8_t, uint8_t, uint8_t ){}
+void lightLed( void ){}
+void flushLed( void ){}
+uint8_t* putOutputDeviceState( uint8_t* buf ){ return display.health().put(buf, DEV_ID_DISPLAY);}
+
+/*----------------------------------------------------------------------------*/
+//
+//     SAXduino.ino
+//
+/*----------------------------------------------------------------------------*/
+void hostMidiReceive( uint32_t time, uint8_t dt )
+{
+  HostByte rx = { time, dt };
+  hostRx.push_back(rx);
+}
+/*----------------------------------------------------------------------------*/
+void hostSetup( void )
+{
+  parameter_init();
+  display.init();
+  hostFlute.initTouch();
+#ifdef USE_PROFILER
+  profiler_init();
+#endif
+  hostAdvance(600000);    //  Opening
+  hostFlute.init();
+}
+/*----------------------------------------------------------------------------*/
+void hostLoop( void )
+{
+  main_loop(hostFlute, hostMidiIn);
+}
+/*----------------------------------------------------------------------------*/
+void hostRun( uint32_t us )
+{
+  const uint32_t end = hostMicros + us;
+  while ( static_cast<int32_t>(hostMicros - end) < 0 ){
+    hostLoop();
+  }
+}
@@ -0,0 +1,56 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  host_platform.h
+ *    description: Sketch Platform for Host Simulation
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#ifndef HOST_PLATFORM_H
+#define HOST_PLATFORM_H
+
+#include <Arduino.h>
+#include <vector>
+#include "magicflute.h"
+#include "midi_receiver.h"
+
+//  Sensors are the simulated devices of host_device.h
+
+//  MIDI output through Serial TX ( 64 byte buffer, 31250bps )
+//    parsed with running status, stamped when the last byte is sent
+struct HostMidi {
+  uint32_t  time;     //  usec
+  uint8_t   status;
+  uint8_t   data1;    //  0xff: realtime message
+  uint8_t   data2;    //  0xff: 2 byte message
+};
+struct HostSysEx {
+  uint32_t  time;
+  std::vector<uint8_t>  data;   //  without F0/F7
+};
+struct HostByte {
+  uint32_t  time;     //  usec, when it arrives at the receiver
+  uint8_t   dt;
+};
+extern std::vector<HostMidi>  hostMidi;
+extern std::vector<HostSysEx> hostSysEx;
+extern std::vector<HostByte>  hostTx;     //  raw bytes
+
+//  MIDI input, read by loop() once the time has come
+void hostMidiReceive( uint32_t time, uint8_t dt );
+
+//  the sketch, as in SAXduino.ino
+extern MagicFlute   hostFlute;
+extern MidiReceiver hostMidiIn;
+
+//  setup() and loop() of SAXduino.ino, loop() is the shared main_loop()
+void hostSetup( void );
+void hostLoop( void );
+
+//  loop() until the time has passed
+void hostRun( uint32_t us );
+
+#endif
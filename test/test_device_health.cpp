@@ -0,0 +1,123 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  test_device_health.cpp
+ *    description: Device Report of SysEx 37 & Recovery ( host )
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#include <stdio.h>
+#include "host_platform.h"
+#include "host_device.h"
+#include "device.h"
+
+//  Built with USE_ADXL345. Every device fails on the bus for a while,
+//  and the report is read by SysEx F0 7D 17 F7:
+//    - one entry a device: pressure, touch, ADXL345 and ADA88
+//    - a failing device is offline, and counts its errors
+//    - once the bus is back, every device is online again after its
+//      backoff, and keeps the error count since power on
+
+/*----------------------------------------------------------------------------*/
+#define   STANDARD_PRS      2000
+#define   RUN_US            1000000UL
+#define   RECOVER_US        5000000UL   //  over the longest backoff
+
+static const uint8_t deviceId[] = { DEV_ID_PRESSURE, DEV_ID_TOUCH, DEV_ID_MOTION, DEV_ID_DISPLAY };
+static const char* const deviceName[] = { "pressure", "touch", "ADXL345", "ADA88", "PCA9685" };
+#define   DEVICE_NUM        (sizeof(deviceId)/sizeof(deviceId[0]))
+
+struct Entry {
+  bool      found;
+  bool      online;
+  uint16_t  errors;
+};
+
+static int failCount = 0;
+static void fail( const char* what, int id )
+{
+  if ( failCount++ < 20 ){ printf("FAIL %s: %s\n", deviceName[id], what);}
+}
+
+/*----------------------------------------------------------------------------*/
+//  request the report, returns false without a well formed reply
+static bool readReport( Entry* entry )
+{
+  for ( int i=0; i<DEV_ID_MAX; i++ ){ entry[i].found = false;}
+  const size_t top = hostSysEx.size();
+  hostMidiReceive(hostMicros, 0xf0);
+  hostMidiReceive(hostMicros, 0x7d);
+  hostMidiReceive(hostMicros, 0x17);
+  hostMidiReceive(hostMicros, 0xf7);
+  hostRun(RUN_US/20);
+
+  for ( size_t i=top; i<hostSysEx.size(); i++ ){
+    const std::vector<uint8_t>& d = hostSysEx[i].data;
+    if (( d.size() < 2 ) || ( d[1] != 0x37 )){ continue;}
+    if (( d.size() - 2 ) % DEV_REPORT_SIZE != 0 ){ return false;}
+    for ( size_t p=2; p<d.size(); p+=DEV_REPORT_SIZE ){
+      const uint8_t id = d[p];
+      if (( id >= DEV_ID_MAX ) || ( entry[id].found == true )){ return false;}
+      entry[id].found = true;
+      entry[id].online = ( d[p+1] != 0 );
+      entry[id].errors = static_cast<uint16_t>((d[p+2] << 7) | d[p+3]);
+    }
+    return true;
+  }
+  return false;
+}
+static void setFail( bool fail )
+{
+  hostPressureFail = fail;
+  hostTouchFail = fail;
+  hostMotionFail = fail;
+  hostDisplayFail = fail;
+}
+
+/*----------------------------------------------------------------------------*/
+int main( void )
+{
+  hostKeys = 0;
+  hostPressure = STANDARD_PRS;
+  hostSetup();
+  hostRun(RUN_US);
+
+  Entry entry[DEV_ID_MAX];
+  if ( readReport(entry) == false ){ fail("no report", DEV_ID_PRESSURE); return 1;}
+  for ( size_t i=0; i<DEVICE_NUM; i++ ){
+    const int id = deviceId[i];
+    if ( entry[id].found == false ){ fail("not reported", id); continue;}
+    if (( entry[id].online == false ) || ( entry[id].errors != 0 )){ fail("not healthy at first", id);}
+  }
+  if ( entry[DEV_ID_LED].found == true ){ fail("reported without USE_PCA9685", DEV_ID_LED);}
+
+  //  bus down
+  setFail(true);
+  hostRun(RUN_US);
+  uint16_t errors[DEV_ID_MAX] = {0};
+  if ( readReport(entry) == false ){ fail("no report while failing", DEV_ID_PRESSURE); return 1;}
+  for ( size_t i=0; i<DEVICE_NUM; i++ ){
+    const int id = deviceId[i];
+    if ( entry[id].online == true ){ fail("online while failing", id);}
+    if ( entry[id].errors == 0 ){ fail("no error counted", id);}
+    errors[id] = entry[id].errors;
+    printf("%-8s failing: online %d, %u errors\n", deviceName[id], entry[id].online, entry[id].errors);
+  }
+
+  //  bus back
+  setFail(false);
+  hostRun(RECOVER_US);
+  if ( readReport(entry) == false ){ fail("no report after recovery", DEV_ID_PRESSURE); return 1;}
+  for ( size_t i=0; i<DEVICE_NUM; i++ ){
+    const int id = deviceId[i];
+    if ( entry[id].online == false ){ fail("not recovered", id);}
+    if ( entry[id].errors < errors[id] ){ fail("error count is lost", id);}
+    printf("%-8s recovered: online %d, %u errors\n", deviceName[id], entry[id].online, entry[id].errors);
+  }
+
+  printf("%d failures\n", failCount);
+  return ( failCount == 0 )? 0:1;
+}
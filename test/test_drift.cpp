@@ -0,0 +1,129 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  test_drift.cpp
+ *    description: Standard Pressure over a Drift Trace ( host )
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#include <stdio.h>
+#include "host_platform.h"
+
+//  A trace of the sensor is replayed: thermal drift up and down, a step
+//  down, sensor noise, and breaths from pianissimo, just above ZERO_OFFSET
+//  and inside twice the noise band, to forte. The standard must follow the
+//  drift without a note, and must not absorb a breath:
+//    - no lead note while not blowing
+//    - the lead note sounds through the whole breath, pianissimo too
+//    - the note is released soon after the breath
+
+/*----------------------------------------------------------------------------*/
+#define   STANDARD_PRS      2000
+#define   STEP_US           1000UL
+#define   ATTACK_US         150000UL    //  interpolation and Note On
+#define   RELEASE_US        300000UL    //  interpolation and Note Off
+#define   NOISE_PP          6           //  sensor noise, peak to peak
+#define   LEAD_CH           0
+
+//  a segment of the trace: the drift moves linearly from its last value,
+//  the breath is on top of the drift
+struct Segment {
+  uint32_t  ms;
+  int       drift;      //  at the end of the segment
+  int       breath;
+};
+static const Segment trace[] = {
+  {  3000,    0,    0 },    //  power on dead band
+  { 20000,   40,    0 },    //  warming up, 2 counts/sec
+  {  8000,   40,   90 },    //  pianissimo
+  {  3000,   40,    0 },
+  { 20000,  -30,    0 },    //  cooling down
+  {  8000,  -40,   98 },    //  pianissimo in drift, just below twice NOISE_WIDTH
+  {  3000,  -40,    0 },
+  {  3000,  -40,  600 },
+  {  3000,  -40,    0 },
+  {   500, -240,    0 },    //  sensor step down, rebased fast
+  {  3000, -240,    0 },
+  { 10000, -240,   85 },    //  long pianissimo
+  {  5000, -220,    0 },
+  {  2000, -220, 1200 },
+  {  3000, -220,    0 },
+};
+
+static uint32_t randState = 1;
+static uint32_t rnd( uint32_t range )
+{
+  //  xorshift32
+  randState ^= randState << 13;
+  randState ^= randState >> 17;
+  randState ^= randState << 5;
+  return randState % range;
+}
+
+static int failCount = 0;
+static void fail( const char* what, size_t seg )
+{
+  if ( failCount++ < 20 ){
+    printf("FAIL segment %lu at %.3f sec: %s\n", (unsigned long)seg, hostMicros/1e6, what);
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+//  lead notes sounding, from MIDI output
+static size_t midiRead = 0;
+static int leadSounding = 0;
+static void feedLead( void )
+{
+  for ( ; midiRead<hostMidi.size(); midiRead++ ){
+    const HostMidi& m = hostMidi[midiRead];
+    if (( m.status & 0x0f ) != LEAD_CH ){ continue;}
+    if ((( m.status & 0xf0 ) == 0x90 ) && ( m.data2 != 0 )){ leadSounding++;}
+    else if ((( m.status & 0xf0 ) == 0x80 ) || (( m.status & 0xf0 ) == 0x90 )){ leadSounding--;}
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+int main( void )
+{
+  hostKeys = 0;
+  hostPressure = STANDARD_PRS;
+  hostSetup();
+
+  int drift = 0;
+  uint32_t soundUs = 0;
+  for ( size_t s=0; s<sizeof(trace)/sizeof(trace[0]); s++ ){
+    const Segment& sg = trace[s];
+    const int from = drift;
+    const uint32_t start = hostMicros;
+    const uint32_t length = sg.ms*1000;
+    bool soundLost = false, soundLate = false;
+
+    for ( uint32_t in=0; in<length; in=hostMicros-start ){
+      drift = from + static_cast<int>(static_cast<int32_t>(sg.drift - from)*static_cast<int32_t>(in/1000)/static_cast<int32_t>(sg.ms));
+      hostPressure = STANDARD_PRS + drift + sg.breath + static_cast<int>(rnd(NOISE_PP+1)) - NOISE_PP/2;
+      const uint32_t before = hostMicros;
+      hostRun(STEP_US);
+      feedLead();
+
+      if ( sg.breath != 0 ){
+        if ( leadSounding > 0 ){ soundUs += hostMicros - before;}
+        if (( in > ATTACK_US ) && ( leadSounding == 0 )){
+          if ( soundLost == false ){ fail("the breath is absorbed by the standard", s);}
+          soundLost = true;
+        }
+      }
+      else if (( s > 0 ) && ( in > RELEASE_US ) && ( leadSounding != 0 )){
+        if ( soundLate == false ){ fail("a note without a breath", s);}
+        soundLate = true;
+      }
+    }
+    drift = sg.drift;
+  }
+
+  printf("%.0f sec of drift trace, lead sounding %.1f sec, %d failures\n",
+         hostMicros/1e6, soundUs/1e6, failCount);
+  return ( failCount == 0 )? 0:1;
+}
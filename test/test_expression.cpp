@@ -0,0 +1,186 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  test_expression.cpp
+ *    description: 14bit Expression Monotonicity & Bandwidth ( host )
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#include <stdio.h>
+#include "host_platform.h"
+#include "configuration.h"
+#include "parameter.h"
+
+//  Swells of several speeds and levels are blown, and the expression is
+//  read as a receiver does: CC#11 sets the MSB and clears the LSB, CC#43
+//  sets the LSB. On each CC#43 the 14bit value must:
+//    - not go down while the breath rises, nor up while it falls
+//    - move by at most MIDI_EXP_ITP_STEP of 7bit in a step
+//    - land on a held level in fine steps, the last one within 7bit
+//  and the expression must take at most one pair a 10msec tick, and
+//  nothing once the breath is held.
+
+/*----------------------------------------------------------------------------*/
+#define   STANDARD_PRS      2000
+#define   TICK_US           10000UL
+#define   STEP_US           500UL
+#define   SETTLE_US         300000UL    //  moving average and interpolation
+#define   HOLD_US           1000000UL
+#define   LEAD_CH           0
+#define   FINE_STEP         128         //  7bit resolution in 14bit
+
+struct Swell {
+  int       level;      //  breath
+  uint32_t  riseUs;
+  uint32_t  fallUs;
+};
+static const Swell swell[] = {
+  {  150,      0,       0 },
+  {  400,  20000,   20000 },
+  {  700,      0,  300000 },
+  { 1200, 100000,       0 },
+  { 1200, 500000,  500000 },
+  { 2000,   5000,    5000 },
+  {  300, 2000000, 2000000 },
+  {  900,  50000,  200000 },
+};
+
+static int failCount = 0;
+static void fail( const char* what, size_t sw )
+{
+  if ( failCount++ < 20 ){
+    printf("FAIL swell %lu at %.3f sec: %s\n", (unsigned long)sw, hostMicros/1e6, what);
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+//     Receiver of CC#11/CC#43
+/*----------------------------------------------------------------------------*/
+struct ExpValue {
+  uint32_t  time;
+  uint16_t  value;
+};
+static size_t midiRead = 0;
+static uint16_t recvExp = 0;
+static uint32_t expBytes = 0;
+static std::vector<ExpValue> received;
+
+static void receive( void )
+{
+  for ( ; midiRead<hostMidi.size(); midiRead++ ){
+    const HostMidi& m = hostMidi[midiRead];
+    if ( m.status != ( 0xb0 | LEAD_CH )){ continue;}
+    if ( m.data1 == 0x0b ){
+      recvExp = static_cast<uint16_t>(m.data2 << 7);
+      expBytes += 2;    //  running status
+    }
+    else if ( m.data1 == 0x2b ){
+      recvExp = static_cast<uint16_t>(( recvExp & 0x3f80 ) | m.data2 );
+      expBytes += 2;
+      const ExpValue ev = { m.time, recvExp };
+      received.push_back(ev);
+    }
+  }
+}
+/*----------------------------------------------------------------------------*/
+//  breath along a linear ramp, returns the first value received in it
+static size_t blow( int from, int to, uint32_t us )
+{
+  const size_t top = received.size();
+  const uint32_t start = hostMicros;
+  for ( uint32_t t=0; t<us; t=hostMicros-start ){
+    hostPressure = STANDARD_PRS + from + static_cast<int>(static_cast<int64_t>(to - from)*t/us);
+    hostRun(STEP_US);
+    receive();
+  }
+  hostPressure = STANDARD_PRS + to;
+  return top;
+}
+/*----------------------------------------------------------------------------*/
+//  direction: 1 rising, -1 falling
+static void checkMonotonic( size_t from, size_t to, int direction, size_t sw )
+{
+  for ( size_t i=from+1; i<to; i++ ){
+    const int diff = static_cast<int>(received[i].value) - received[i-1].value;
+    if ( diff*direction < 0 ){
+      printf("  %04x -> %04x\n", received[i-1].value, received[i].value);
+      fail(( direction > 0 )? "expression goes down in a rise":"expression goes up in a fall", sw);
+      return;
+    }
+  }
+}
+/*----------------------------------------------------------------------------*/
+static void checkSteps( size_t from, size_t to, size_t sw, bool landing )
+{
+  const int maxStep = prm(PRM_MIDI_EXP_ITP_STEP)*129;
+  for ( size_t i=from+1; i<to; i++ ){
+    int diff = static_cast<int>(received[i].value) - received[i-1].value;
+    if ( diff < 0 ){ diff = -diff;}
+    if ( diff > maxStep ){ fail("a step over MIDI_EXP_ITP_STEP", sw); return;}
+  }
+  if (( landing == true ) && ( to >= from+2 )){
+    int last = static_cast<int>(received[to-1].value) - received[to-2].value;
+    if ( last < 0 ){ last = -last;}
+    if ( last >= FINE_STEP ){
+      printf("  last step %d\n", last);
+      fail("lands on the level by a coarse step", sw);
+    }
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+int main( void )
+{
+  hostKeys = 0;
+  hostPressure = STANDARD_PRS;
+  hostSetup();
+  hostRun(2*HOLD_US);   //  power on dead band of AirPressure
+  receive();
+
+  uint32_t maxPairs = 0, maxBytes = 0;
+  for ( size_t s=0; s<sizeof(swell)/sizeof(swell[0]); s++ ){
+    const Swell& sw = swell[s];
+    const uint32_t bytesBefore = expBytes;
+    const uint32_t start = hostMicros;
+
+    //  rise and hold
+    const size_t rise = blow(0, sw.level, sw.riseUs);
+    blow(sw.level, sw.level, SETTLE_US);
+    const size_t held = received.size();
+    blow(sw.level, sw.level, HOLD_US);
+    if ( received.size() != held ){ fail("expression while the breath is held", s);}
+    checkMonotonic(( rise > 0 )? rise-1:rise, held, 1, s);
+    checkSteps(( rise > 0 )? rise-1:rise, held, s, true);
+
+    //  fall and rest
+    const size_t fall = blow(sw.level, 0, sw.fallUs);
+    blow(0, 0, SETTLE_US);
+    const size_t rest = received.size();
+    blow(0, 0, HOLD_US);
+    if ( received.size() != rest ){ fail("expression while not blowing", s);}
+    checkMonotonic(fall-1, rest, -1, s);
+    checkSteps(fall-1, rest, s, false);
+
+    //  bandwidth: at most a pair a tick
+    uint32_t pairs = 0;
+    for ( size_t i=rise; i<rest; i++ ){
+      if (( i > rise ) && ( received[i].time/TICK_US == received[i-1].time/TICK_US )){
+        fail("two expression pairs in a tick", s);
+      }
+      pairs++;
+    }
+    const uint32_t bytes = (expBytes - bytesBefore)*1000000ULL/(hostMicros - start);
+    if ( pairs > maxPairs ){ maxPairs = pairs;}
+    if ( bytes > maxBytes ){ maxBytes = bytes;}
+    printf("swell %4d rise %4lu fall %4lu msec: %3lu pairs, peak %04x\n", sw.level,
+           (unsigned long)sw.riseUs/1000, (unsigned long)sw.fallUs/1000, (unsigned long)pairs,
+           received[held-1].value);
+  }
+
+  printf("%lu expression pairs, at most %lu a swell, %lu byte/sec, %d failures\n",
+         (unsigned long)received.size(), (unsigned long)maxPairs, (unsigned long)maxBytes, failCount);
+  return ( failCount == 0 )? 0:1;
+}
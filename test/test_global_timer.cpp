@@ -0,0 +1,103 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  test_global_timer.cpp
+ *    description: GlobalTimer over Wrap Around and Stalls ( host )
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#include <stdio.h>
+#include "TouchMIDI_AVR_if.h"
+
+//  The ISR ticks are counted against the 10msec, 100msec and 1sec counters
+//  of updateTimer(). Whatever the start tick and however long the loop
+//  stalls between the calls, the counters must hold every tick:
+//    - across the wrap around of the 32bit tick
+//    - after stalls of 0 to several seconds, each event fires once a call
+
+/*----------------------------------------------------------------------------*/
+static int failCount = 0;
+static void fail( const char* what, uint32_t start, uint32_t at )
+{
+  if ( failCount++ < 20 ){
+    printf("FAIL start %08lx tick %lu: %s\n", (unsigned long)start, (unsigned long)at, what);
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t randState = 1;
+static uint32_t rnd( uint32_t range )
+{
+  //  xorshift32
+  randState ^= randState << 13;
+  randState ^= randState >> 17;
+  randState ^= randState << 5;
+  return randState % range;
+}
+
+/*----------------------------------------------------------------------------*/
+//  stalls: the ticks counted by ISR between two updateTimer() calls
+static void run( uint32_t start, uint32_t maxStall, uint32_t total )
+{
+  GlobalTimer tm(start);
+  uint32_t ticks = 0;
+  uint32_t ev100 = 0, ev1s = 0;
+
+  while ( ticks < total ){
+    const uint32_t stall = rnd(maxStall+1);
+    for ( uint32_t i=0; i<stall; i++ ){ tm.incGlobalTime();}
+    const uint32_t before100 = tm.timer100ms(), before1s = tm.timer1s();
+
+    const uint32_t diff = tm.updateTimer();
+    ticks += stall;
+
+    if ( diff != stall ){ fail("elapsed ticks differ", start, ticks);}
+    if ( tm.globalTime() != start + ticks ){ fail("tick is not the ISR count", start, ticks);}
+    if ( tm.timer10msecEvent() != ( stall > 0 )){ fail("10msec event", start, ticks);}
+    if ( tm.timer10ms() != ticks ){ fail("10msec counter lost a tick", start, ticks);}
+    if ( tm.timer100ms() != ticks/10 ){ fail("100msec counter lost a tick", start, ticks);}
+    if ( tm.timer1s() != ticks/100 ){ fail("1sec counter lost a tick", start, ticks);}
+    if ( tm.timer100msecEvent() != ( tm.timer100ms() != before100 )){ fail("100msec event", start, ticks);}
+    if ( tm.timer1secEvent() != ( tm.timer1s() != before1s )){ fail("1sec event", start, ticks);}
+    if ( tm.timer100msecEvent() == true ){ ev100++;}
+    if ( tm.timer1secEvent() == true ){ ev1s++;}
+  }
+
+  //  a call without a tick clears all the events
+  tm.updateTimer();
+  if (( tm.timer10msecEvent() == true ) || ( tm.timer100msecEvent() == true ) ||
+      ( tm.timer1secEvent() == true )){
+    fail("an event without a tick", start, ticks);
+  }
+  printf("start %08lx stall <= %4lu: %6lu ticks, %5lu 100msec and %4lu 1sec events\n",
+         (unsigned long)start, (unsigned long)maxStall, (unsigned long)ticks,
+         (unsigned long)ev100, (unsigned long)ev1s);
+}
+
+/*----------------------------------------------------------------------------*/
+int main( void )
+{
+  static const uint32_t startTick[] = { 0, 0xffffffffUL - 500, 0xffffffffUL, 0x7fffffffUL - 3 };
+  static const uint32_t maxStall[] = { 1, 3, 15, 250, 1000 };
+
+  for ( size_t s=0; s<sizeof(startTick)/sizeof(startTick[0]); s++ ){
+    for ( size_t m=0; m<sizeof(maxStall)/sizeof(maxStall[0]); m++ ){
+      run(startTick[s], maxStall[m], 20000);
+    }
+  }
+
+  //  one stall over the wrap around
+  GlobalTimer tm(0xffffffffUL - 99);
+  for ( int i=0; i<1234; i++ ){ tm.incGlobalTime();}
+  if (( tm.updateTimer() != 1234 ) || ( tm.timer10ms() != 1234 ) ||
+      ( tm.timer100ms() != 123 ) || ( tm.timer1s() != 12 ) ||
+      ( tm.timer100msecEvent() == false ) || ( tm.timer1secEvent() == false )){
+    fail("a stall over the wrap around", 0xffffffffUL - 99, 1234);
+  }
+
+  printf("%d failures\n", failCount);
+  return ( failCount == 0 )? 0:1;
+}
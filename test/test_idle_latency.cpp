@@ -0,0 +1,137 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  test_idle_latency.cpp
+ *    description: Note On from Idle against the Awake Loop ( host )
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#include <stdio.h>
+#include "host_platform.h"
+
+//  The same breath is blown from idle ( USE_IDLE_SLEEP ) and from the
+//  awake loop, which is kept awake by a held finger key. Idle must not
+//  add latency to Note On, must not change the velocity of the attack,
+//  and must not read the sensor more often than the awake loop.
+
+/*----------------------------------------------------------------------------*/
+#define   STANDARD_PRS      2000
+#define   TICK_US           10000UL
+#define   RELEASE_US        2000000UL
+#define   MEASURE_US        1000000UL
+#define   RATE_US           1000000UL
+#define   AWAKE_KEY         0x0001      //  key 0, the lowest finger
+#define   VELOCITY_DIFF     8           //  average, of a step the slope is coarse
+#define   WAKE_US           1000        //  idle wakes up by Timer0
+#define   PHASE_STEP_US     100
+
+static const int breathLevel[] = { 200, 300, 600, 1200 };
+static const uint32_t rampUs[] = { 0, 20000, 60000 };
+
+static int failCount = 0;
+
+/*----------------------------------------------------------------------------*/
+struct Attack {
+  uint32_t  latency;    //  usec
+  uint8_t   velocity;
+};
+static Attack noteOn( int breath, uint32_t ramp, uint32_t phase, bool awake )
+{
+  hostKeys = ( awake == true )? AWAKE_KEY:0;
+  hostPressure = STANDARD_PRS;
+  hostRun(RELEASE_US);
+  if ( hostFlute.isIdle() == awake ){
+    printf("FAIL: %s before the breath\n", ( awake == true )? "idle":"awake");
+    failCount++;
+  }
+
+  //  the breath starts at the same phase of 10msec tick in both
+  const uint32_t start = (hostMicros/TICK_US + 2)*TICK_US + phase;
+  Attack at = { MEASURE_US, 0 };
+  const size_t top = hostMidi.size();
+  while (( hostMicros < start + MEASURE_US ) && ( at.velocity == 0 )){
+    const int32_t t = static_cast<int32_t>(hostMicros - start);
+    hostPressure = STANDARD_PRS;
+    if ( t >= static_cast<int32_t>(ramp) ){ hostPressure += breath;}
+    else if ( t > 0 ){ hostPressure += static_cast<int>(breath*t/ramp);}
+    hostLoop();
+    for ( size_t i=top; i<hostMidi.size(); i++ ){
+      if ((( hostMidi[i].status & 0xf0 ) == 0x90 ) && ( hostMidi[i].data2 != 0 )){
+        at.latency = hostMidi[i].time - start;
+        at.velocity = hostMidi[i].data2;
+        break;
+      }
+    }
+  }
+  hostPressure = STANDARD_PRS;
+  hostRun(RELEASE_US);
+  return at;
+}
+/*----------------------------------------------------------------------------*/
+static double readRate( bool awake )
+{
+  hostKeys = ( awake == true )? AWAKE_KEY:0;
+  hostPressure = STANDARD_PRS;
+  hostRun(RELEASE_US);
+  const uint32_t read = hostPressureRead;
+  hostRun(RATE_US);
+  return (hostPressureRead - read)*1e6/RATE_US;
+}
+/*----------------------------------------------------------------------------*/
+int main( void )
+{
+  hostPressure = STANDARD_PRS;
+  hostSetup();
+  hostRun(RELEASE_US);    //  power on dead band of AirPressure
+  hostPressure = STANDARD_PRS + breathLevel[0];
+  hostRun(RELEASE_US);    //  a note, then the mute time after it
+
+  uint32_t worst = 0;
+  for ( size_t b=0; b<sizeof(breathLevel)/sizeof(breathLevel[0]); b++ ){
+    for ( size_t r=0; r<sizeof(rampUs)/sizeof(rampUs[0]); r++ ){
+      //  over all phases of 10msec tick and of the loop
+      uint32_t sum[2] = { 0, 0 }, max[2] = { 0, 0 };
+      int vel[2] = { 0, 0 };
+      for ( uint32_t phase=0; phase<TICK_US; phase+=PHASE_STEP_US ){
+        for ( int awake=0; awake<2; awake++ ){
+          const Attack at = noteOn(breathLevel[b], rampUs[r], phase, awake == 1);
+          if ( at.velocity == 0 ){
+            printf("FAIL breath %d ramp %lu phase %lu: no Note On\n",
+                   breathLevel[b], (unsigned long)rampUs[r], (unsigned long)phase);
+            failCount++;
+          }
+          sum[awake] += at.latency;
+          if ( at.latency > max[awake] ){ max[awake] = at.latency;}
+          vel[awake] += at.velocity;
+        }
+      }
+      const int num = TICK_US/PHASE_STEP_US;
+      const int vdiff = (vel[0] - vel[1])/num;
+      printf("breath %4d ramp %2lu msec: idle %5.1f/%5.1f msec vel %3d, awake %5.1f/%5.1f msec vel %3d\n",
+             breathLevel[b], (unsigned long)rampUs[r]/1000,
+             sum[0]/1000.0/num, max[0]/1000.0, vel[0]/num, sum[1]/1000.0/num, max[1]/1000.0, vel[1]/num);
+      //  no added latency: the worst is not later, the average is
+      //  within the wake up grid of idle
+      if (( sum[0] > sum[1] + WAKE_US*num ) || ( max[0] > max[1] ) ||
+          ( vdiff > VELOCITY_DIFF ) || ( vdiff < -VELOCITY_DIFF )){
+        printf("FAIL: idle is later or its velocity differs\n");
+        failCount++;
+      }
+      if ( max[1] > worst ){ worst = max[1];}
+    }
+  }
+
+  const double awakeRate = readRate(true);
+  const double idleRate = readRate(false);
+  if ( idleRate > awakeRate ){
+    printf("FAIL: idle reads %.0f/sec, awake %.0f/sec\n", idleRate, awakeRate);
+    failCount++;
+  }
+
+  printf("Note On within %.1f msec, sensor read %.0f/sec idle, %.0f/sec awake, %d failures\n",
+         worst/1000.0, idleRate, awakeRate, failCount);
+  return ( failCount == 0 )? 0:1;
+}
@@ -0,0 +1,266 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  test_magicflute.cpp
+ *    description: Property Test of Fingering & Dead Band ( host )
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "host_platform.h"
+#include "parameter.h"
+
+//  random touch/breath sequences through MagicFlute, with tone and
+//  transpose keys and MIDI input, and invariants:
+//    - no Note On for a sounding note, no Note Off for a silent note
+//    - no All Note Off while a note of the channel sounds
+//    - all notes are released after the breath
+//    - the dead band resolves to the note of the fingering in time
+//    - no MIDI output while nothing changes
+//  and a parameter written by NRPN is set by CC38, not by CC6 alone.
+//  The invariants are checked in each harmony mode first, with the
+//  voices of the mode on ch.2-4, then with random tone/transpose keys.
+
+/*----------------------------------------------------------------------------*/
+#define   STANDARD_PRS      2000
+#define   SEQUENCE_NUM      2000
+#define   SEGMENT_MAX       8
+#define   TICK_US           10000UL
+#define   RELEASE_US        2000000UL
+#define   QUIET_US          1000000UL
+#define   HOLD_US           1500000UL
+#define   HARMONY_MODE_NUM  6
+#define   HARMONY_SEQ_NUM   200
+#define   GESTURE_US        100000UL
+
+//  ch.2-4 used in each harmony mode: off, oct down, 5th, 3rd, triad, power
+static const uint8_t harmonyVoice[HARMONY_MODE_NUM] = { 0x0, 0x1, 0x1, 0x1, 0x3, 0x7 };
+
+static const int breathLevel[] = { 0, 40, 120, 300, 600, 1200 };
+
+static uint32_t randState = 1;
+static uint32_t rnd( uint32_t range )
+{
+  //  xorshift32
+  randState ^= randState << 13;
+  randState ^= randState >> 17;
+  randState ^= randState << 5;
+  return randState % range;
+}
+
+static int failCount = 0;
+static void fail( const char* what, uint32_t seq )
+{
+  if ( failCount++ < 20 ){
+    printf("FAIL seq %lu at %lu usec: %s\n", (unsigned long)seq, (unsigned long)hostMicros, what);
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+//     Note On/Off balance from MIDI output
+/*----------------------------------------------------------------------------*/
+class NoteChecker {
+public:
+  NoteChecker( void ) : _read(0), _sounding() {}
+
+  //  returns false at a broken pair
+  bool  feed( void )
+  {
+    bool ok = true;
+    for ( ; _read<hostMidi.size(); _read++ ){
+      const HostMidi& m = hostMidi[_read];
+      const uint8_t ch = m.status & 0x0f;
+      const uint8_t note = m.data1 & 0x7f;
+      if ((( m.status & 0xf0 ) == 0x90 ) && ( m.data2 != 0 )){
+        if ( _sounding[ch][note] ){ ok = false;}
+        _sounding[ch][note] = true;
+      }
+      else if ((( m.status & 0xf0 ) == 0x80 ) || (( m.status & 0xf0 ) == 0x90 )){
+        if ( !_sounding[ch][note] ){ ok = false;}
+        _sounding[ch][note] = false;
+      }
+      else if ((( m.status & 0xf0 ) == 0xb0 ) && ( m.data1 == 0x7b )){
+        for ( int nt=0; nt<128; nt++ ){
+          if ( _sounding[ch][nt] ){ ok = false;}
+          _sounding[ch][nt] = false;
+        }
+      }
+    }
+    return ok;
+  }
+  int   soundingNum( void ) const
+  {
+    int num = 0;
+    for ( int ch=0; ch<16; ch++ ){
+      for ( int nt=0; nt<128; nt++ ){ if ( _sounding[ch][nt] ){ num++;}}
+    }
+    return num;
+  }
+
+private:
+  size_t  _read;
+  bool    _sounding[16][128];
+};
+
+/*----------------------------------------------------------------------------*/
+static void setTouch( uint8_t tch, uint8_t ctrl=0 )
+{
+  //  MagicFlute::checkSixTouch(): key 5 is bit0 of tch ... key 0 is bit5
+  //  tone and transpose keys are key 6-9
+  uint32_t keys = static_cast<uint32_t>(ctrl & 0x0f) << 6;
+  for ( int i=0; i<6; i++ ){
+    if ( tch & (1<<i) ){ keys |= 1<<(5-i);}
+  }
+  hostKeys = keys;
+}
+/*----------------------------------------------------------------------------*/
+static void receiveRandomMessage( uint32_t time )
+{
+  if ( rnd(2) == 0 ){
+    //  RPN 0/2 coarse tune: transpose
+    const uint8_t msg[9] = { 0xb0, 0x65, 0x00, 0xb0, 0x64, 0x02, 0xb0, 0x06,
+                             static_cast<uint8_t>(64 - 6 + rnd(12)) };
+    for ( int i=0; i<9; i++ ){ hostMidiReceive(time, msg[i]);}
+  }
+  else {
+    //  tone
+    hostMidiReceive(time, 0xc0);
+    hostMidiReceive(time, static_cast<uint8_t>(rnd(8)));
+  }
+}
+/*----------------------------------------------------------------------------*/
+static uint32_t deadBandMaxUs( void )
+{
+  //  longest dead band ( 3 points ), plus detection and one tick
+  return (3*prm(PRM_DEADBAND_POINT_TIME) + 3)*TICK_US;
+}
+/*----------------------------------------------------------------------------*/
+static void runSequence( NoteChecker& chk, uint32_t seq, bool ctrl=true )
+{
+  uint8_t tch = 0;
+  int segNum = 1 + rnd(SEGMENT_MAX);
+
+  for ( int s=0; s<segNum; s++ ){
+    tch = static_cast<uint8_t>(rnd(64));
+    setTouch(tch, ( ctrl && ( rnd(4) == 0 ))? static_cast<uint8_t>(rnd(16)):0);
+    hostPressure = STANDARD_PRS + breathLevel[rnd(sizeof(breathLevel)/sizeof(breathLevel[0]))];
+
+    //  short ones hit the dead band, long ones let it resolve
+    const bool settle = ( rnd(3) == 0 );
+    const uint32_t len = settle? deadBandMaxUs() + rnd(20)*TICK_US : (1 + rnd(15))*TICK_US;
+    if ( rnd(4) == 0 ){ receiveRandomMessage(hostMicros + rnd(len));}
+    hostRun(len);
+    if ( !chk.feed() ){ fail("note on/off pair is broken", seq);}
+
+    if ( settle && ( hostFlute.crntNote() != MagicFlute::fingeringNote(tch) )){
+      fail("dead band is not resolved", seq);
+    }
+  }
+
+  //  hold: nothing changes, nothing is sent
+  setTouch(tch);
+  hostPressure = STANDARD_PRS + breathLevel[1 + rnd(sizeof(breathLevel)/sizeof(breathLevel[0]) - 1)];
+  hostRun(HOLD_US);
+  chk.feed();
+  size_t top = hostMidi.size();
+  hostRun(QUIET_US/2);
+  if ( hostMidi.size() != top ){ fail("MIDI while holding the same breath", seq);}
+
+  //  release
+  hostPressure = STANDARD_PRS;
+  hostRun(RELEASE_US);
+  if ( !chk.feed() ){ fail("note on/off pair is broken at release", seq);}
+  if ( chk.soundingNum() != 0 ){ fail("a note is left after release", seq);}
+
+  top = hostMidi.size();
+  hostRun(QUIET_US);
+  if ( hostMidi.size() != top ){ fail("MIDI while nothing changes", seq);}
+  chk.feed();
+}
+/*----------------------------------------------------------------------------*/
+//  the sequences in each harmony mode, changed by the gesture of
+//  holding a transpose key and touching a tone key, while not playing
+static void runHarmonyModes( NoteChecker& chk )
+{
+  for ( int mode=0; mode<HARMONY_MODE_NUM; mode++ ){
+    const size_t top = hostMidi.size();
+    for ( uint32_t seq=0; seq<HARMONY_SEQ_NUM; seq++ ){ runSequence(chk, seq, false);}
+
+    uint8_t voice = 0;
+    for ( size_t i=top; i<hostMidi.size(); i++ ){
+      const HostMidi& m = hostMidi[i];
+      const uint8_t ch = m.status & 0x0f;
+      if ((( m.status & 0xf0 ) == 0x90 ) && ( m.data2 != 0 ) && ( ch >= 1 ) && ( ch <= 3 )){
+        voice |= static_cast<uint8_t>(1 << (ch-1));
+      }
+    }
+    if ( voice != harmonyVoice[mode] ){
+      printf("  harmony mode %d: voices %x\n", mode, voice);
+      fail("harmony voices differ from the mode", mode);
+    }
+
+    setTouch(0, 0x08);
+    hostRun(GESTURE_US);
+    setTouch(0, 0x0a);
+    hostRun(GESTURE_US);
+    setTouch(0, 0x08);
+    hostRun(GESTURE_US);
+    setTouch(0);
+    hostRun(GESTURE_US);
+    if ( !chk.feed() ){ fail("note on/off pair is broken by the harmony mode", mode);}
+  }
+}
+/*----------------------------------------------------------------------------*/
+static void receiveNrpn( uint8_t id, int16_t value, bool withLsb )
+{
+  const uint8_t msg[12] = { 0xb0, 0x63, 0x7d, 0xb0, 0x62, id, 0xb0, 0x06,
+                            static_cast<uint8_t>(value >> 7), 0xb0, 0x26,
+                            static_cast<uint8_t>(value & 0x7f) };
+  for ( int i=0; i<( withLsb? 12:9 ); i++ ){ hostMidiReceive(hostMicros, msg[i]);}
+  hostRun(TICK_US);
+}
+static void checkNrpn( void )
+{
+  const int16_t dflt = prm(PRM_STABLE_COUNT);
+  receiveNrpn(PRM_STABLE_COUNT, 200, false);
+  if ( prm(PRM_STABLE_COUNT) != dflt ){ fail("NRPN is written by CC6 alone", 0);}
+  receiveNrpn(PRM_STABLE_COUNT, 200, true);
+  if ( prm(PRM_STABLE_COUNT) != 200 ){ fail("NRPN is not written by CC38", 0);}
+  receiveNrpn(PRM_STABLE_COUNT, dflt, true);
+  if ( prm(PRM_STABLE_COUNT) != dflt ){ fail("NRPN is not written back", 0);}
+}
+/*----------------------------------------------------------------------------*/
+int main( int argc, char* argv[] )
+{
+  randState = ( argc > 1 )? static_cast<uint32_t>(strtoul(argv[1], 0, 0)):1;
+  if ( randState == 0 ){ randState = 1;}
+
+  static NoteChecker chk;
+  hostPressure = STANDARD_PRS;
+  hostSetup();
+  hostRun(2000000);    //  power on dead band of AirPressure
+  checkNrpn();
+  chk.feed();
+  runHarmonyModes(chk);
+
+  const clock_t start = clock();
+  for ( uint32_t seq=0; seq<SEQUENCE_NUM; seq++ ){
+    runSequence(chk, seq);
+    if ( hostMidi.size() > 100000 ){
+      hostMidi.clear();
+      hostSysEx.clear();
+      hostTx.clear();
+      chk = NoteChecker();
+    }
+  }
+  const double sec = static_cast<double>(clock() - start)/CLOCKS_PER_SEC;
+
+  printf("%d sequences, %.0f sequences/sec, %d failures\n",
+         SEQUENCE_NUM, ( sec > 0 )? SEQUENCE_NUM/sec:0.0, failCount);
+  return ( failCount == 0 )? 0:1;
+}
@@ -0,0 +1,226 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  test_midi_merge.cpp
+ *    description: Two Units Chained by USE_MIDI_MERGE ( host )
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "host_platform.h"
+#include "parameter.h"
+
+//  The upstream unit plays and answers SysEx commands of a computer, and
+//  its MIDI output is the input of the merging unit, which plays too.
+//  The sketch is a set of globals, so each unit runs in its own process,
+//  and the upstream one hands its output bytes over through a pipe.
+//  Output of the merging unit:
+//    - every channel message of the upstream unit, in order, channel shifted
+//    - no SysEx: replies of the upstream unit are never taken for commands
+//    - no own note is left after the breath
+
+/*----------------------------------------------------------------------------*/
+#define   STANDARD_PRS      2000
+#define   PLAY_US           20000000UL
+#define   SEGMENT_US        150000UL
+#define   COMMAND_US        400000UL
+#define   RELEASE_US        2000000UL
+
+static const int breathLevel[] = { 0, 300, 600, 1200 };
+
+static uint32_t randState = 1;
+static uint32_t rnd( uint32_t range )
+{
+  //  xorshift32
+  randState ^= randState << 13;
+  randState ^= randState >> 17;
+  randState ^= randState << 5;
+  return randState % range;
+}
+
+static int failCount = 0;
+static void fail( const char* what )
+{
+  if ( failCount++ < 20 ){ printf("FAIL: %s\n", what);}
+}
+
+/*----------------------------------------------------------------------------*/
+//     a computer on the input of the upstream unit
+/*----------------------------------------------------------------------------*/
+static void sendCommand( uint32_t time )
+{
+  const uint8_t id = static_cast<uint8_t>(rnd(PRM_MAX));
+  const uint16_t value = static_cast<uint16_t>(prm(id));
+  uint8_t cmd[6] = { 0x7d, 0, id, static_cast<uint8_t>((value>>7) & 0x7f),
+                     static_cast<uint8_t>(value & 0x7f), 0 };
+  int length = 2;
+  switch ( rnd(7) ){
+    case 0: cmd[1] = 0x10; length = 3; break;   //  read
+    case 1: cmd[1] = 0x12; length = 5; break;   //  write the same value
+    case 2: cmd[1] = 0x13; break;               //  commit
+    case 3: cmd[1] = 0x14; break;               //  read all
+    case 4: cmd[1] = 0x15; break;               //  merge wait
+    case 5: cmd[1] = 0x16; break;               //  RAM
+    default: cmd[1] = 0x17; break;              //  devices
+  }
+  hostMidiReceive(time, 0xf0);
+  for ( int i=0; i<length; i++ ){ hostMidiReceive(time, cmd[i]);}
+  hostMidiReceive(time, 0xf7);
+}
+/*----------------------------------------------------------------------------*/
+static void play( bool upstream )
+{
+  uint32_t nextCommand = hostMicros + COMMAND_US;
+  const uint32_t end = hostMicros + PLAY_US;
+  while ( static_cast<int32_t>(hostMicros - end) < 0 ){
+    hostKeys = rnd(64);
+    hostPressure = STANDARD_PRS + breathLevel[rnd(sizeof(breathLevel)/sizeof(breathLevel[0]))];
+    if (( upstream == true ) && ( static_cast<int32_t>(hostMicros - nextCommand) >= 0 )){
+      sendCommand(hostMicros);
+      nextCommand += rnd(COMMAND_US);
+    }
+    hostRun(rnd(SEGMENT_US));
+  }
+  hostPressure = STANDARD_PRS;
+  hostRun(RELEASE_US);
+}
+
+/*----------------------------------------------------------------------------*/
+//     pipe between the processes
+/*----------------------------------------------------------------------------*/
+template <typename T>
+static void writeAll( int fd, const std::vector<T>& v )
+{
+  const uint32_t num = static_cast<uint32_t>(v.size());
+  if ( write(fd, &num, sizeof(num)) != sizeof(num) ){ exit(2);}
+  const char* p = reinterpret_cast<const char*>(v.data());
+  size_t left = num*sizeof(T);
+  while ( left > 0 ){
+    const ssize_t n = write(fd, p, left);
+    if ( n <= 0 ){ exit(2);}
+    p += n; left -= n;
+  }
+}
+template <typename T>
+static bool readAll( int fd, std::vector<T>& v )
+{
+  uint32_t num = 0;
+  if ( read(fd, &num, sizeof(num)) != sizeof(num) ){ return false;}
+  v.resize(num);
+  char* p = reinterpret_cast<char*>(v.data());
+  size_t left = num*sizeof(T);
+  while ( left > 0 ){
+    const ssize_t n = read(fd, p, left);
+    if ( n <= 0 ){ return false;}
+    p += n; left -= n;
+  }
+  return true;
+}
+/*----------------------------------------------------------------------------*/
+static bool isChannelMessage( const HostMidi& m ){ return m.data1 != 0xff;}
+
+/*----------------------------------------------------------------------------*/
+int main( int argc, char* argv[] )
+{
+  const uint32_t seed = ( argc > 1 )? static_cast<uint32_t>(strtoul(argv[1], 0, 0)):1;
+
+  int fd[2];
+  if ( pipe(fd) != 0 ){ return 2;}
+  const pid_t pid = fork();
+  if ( pid < 0 ){ return 2;}
+
+  hostPressure = STANDARD_PRS;
+  if ( pid == 0 ){
+    //  upstream unit
+    close(fd[0]);
+    randState = seed*2 + 1;
+    hostSetup();
+    play(true);
+    std::vector<uint8_t> reply;
+    for ( size_t i=0; i<hostSysEx.size(); i++ ){
+      if ( hostSysEx[i].data.size() >= 2 ){ reply.push_back(hostSysEx[i].data[1]);}
+    }
+    writeAll(fd[1], hostTx);
+    writeAll(fd[1], hostMidi);
+    writeAll(fd[1], reply);
+    close(fd[1]);
+    _exit(0);
+  }
+
+  //  merging unit, its input is the output of the upstream one
+  close(fd[1]);
+  std::vector<HostByte> upTx;
+  std::vector<HostMidi> upMidi;
+  std::vector<uint8_t> upReply;
+  const bool received = readAll(fd[0], upTx) && readAll(fd[0], upMidi) && readAll(fd[0], upReply);
+  close(fd[0]);
+  int status = 0;
+  waitpid(pid, &status, 0);
+  if (( received == false ) || ( WIFEXITED(status) == 0 ) || ( WEXITSTATUS(status) != 0 )){
+    printf("FAIL: upstream unit\n");
+    return 1;
+  }
+
+  //  the upstream unit did answer with the reply codes
+  const uint8_t replyCode[] = { 0x11, 0x33, 0x35, 0x36, 0x37 };
+  for ( size_t i=0; i<sizeof(replyCode); i++ ){
+    bool found = false;
+    for ( size_t j=0; j<upReply.size(); j++ ){ if ( upReply[j] == replyCode[i] ){ found = true;}}
+    if ( found == false ){ fail("a reply is missing from the upstream unit");}
+  }
+
+  for ( size_t i=0; i<upTx.size(); i++ ){ hostMidiReceive(upTx[i].time, upTx[i].dt);}
+  randState = seed*2 + 2;
+  hostSetup();
+  play(false);
+
+  //  no SysEx, the merging unit got no command
+  if ( hostSysEx.empty() == false ){
+    printf("merging unit sent SysEx %02x\n", ( hostSysEx[0].data.size() >= 2 )? hostSysEx[0].data[1]:0);
+    fail("a reply of the upstream unit is taken for a command");
+  }
+
+  //  own: ch.1-4 ( lead and harmony ), upstream: shifted above them
+  const uint8_t shift = static_cast<uint8_t>(prm(PRM_MERGE_CH_SHIFT));
+  std::vector<HostMidi> own, merged;
+  for ( size_t i=0; i<hostMidi.size(); i++ ){
+    if ( isChannelMessage(hostMidi[i]) == false ){ continue;}
+    if (( hostMidi[i].status & 0x0f ) < shift ){ own.push_back(hostMidi[i]);}
+    else { merged.push_back(hostMidi[i]);}
+  }
+
+  size_t num = 0;
+  for ( size_t i=0; i<upMidi.size(); i++ ){
+    if ( isChannelMessage(upMidi[i]) == false ){ continue;}
+    const uint8_t ch = (upMidi[i].status + shift) & 0x0f;
+    if (( num >= merged.size() ) ||
+        ( merged[num].status != (( upMidi[i].status & 0xf0 ) | ch )) ||
+        ( merged[num].data1 != upMidi[i].data1 ) || ( merged[num].data2 != upMidi[i].data2 )){
+      printf("upstream message %lu of %lu: %02x %02x %02x\n", (unsigned long)num,
+             (unsigned long)upMidi.size(), upMidi[i].status, upMidi[i].data1, upMidi[i].data2);
+      if ( num < merged.size() ){ printf("merged: %02x %02x %02x\n", merged[num].status, merged[num].data1, merged[num].data2);}
+      fail("a merged message is lost or changed");
+      break;
+    }
+    num++;
+  }
+  if ( num != merged.size() ){ fail("the merging unit sent a message of no one");}
+
+  int sounding = 0;
+  for ( size_t i=0; i<own.size(); i++ ){
+    if ((( own[i].status & 0xf0 ) == 0x90 ) && ( own[i].data2 != 0 )){ sounding++;}
+    else if ((( own[i].status & 0xf0 ) == 0x80 ) || (( own[i].status & 0xf0 ) == 0x90 )){ sounding--;}
+  }
+  if ( sounding != 0 ){ fail("an own note is left after the breath");}
+
+  printf("%lu upstream bytes, %lu merged and %lu own messages, %lu replies, %d failures\n",
+         (unsigned long)upTx.size(), (unsigned long)merged.size(), (unsigned long)own.size(),
+         (unsigned long)upReply.size(), failCount);
+  return ( failCount == 0 )? 0:1;
+}
@@ -0,0 +1,95 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  test_motion_bend.cpp
+ *    description: Pitch Bend by Posture, only while Playing ( host )
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#include <stdio.h>
+#include "host_platform.h"
+#include "host_device.h"
+
+//  Built with USE_ADXL345. The instrument is tilted while silent and
+//  while playing. Pitch bend of the lead channel:
+//    - is not sent while silent, whatever the posture
+//    - follows the tilt from the posture at the attack while playing
+//    - goes back to the center once the note is released
+
+/*----------------------------------------------------------------------------*/
+#define   STANDARD_PRS      2000
+#define   BREATH            600
+#define   RUN_US            1000000UL
+#define   BEND_CENTER       0x2000
+#define   LEAD_CH           0
+#define   ONE_G             16384
+
+static int failCount = 0;
+static void fail( const char* what )
+{
+  if ( failCount++ < 20 ){ printf("FAIL at %.3f sec: %s\n", hostMicros/1e6, what);}
+}
+
+/*----------------------------------------------------------------------------*/
+//  pitch bend of the lead channel since top, the last value in *last
+static int bendNum( size_t top, uint16_t* last )
+{
+  int num = 0;
+  for ( size_t i=top; i<hostMidi.size(); i++ ){
+    const HostMidi& m = hostMidi[i];
+    if ( m.status != ( 0xe0 | LEAD_CH )){ continue;}
+    *last = static_cast<uint16_t>(m.data1 | (m.data2 << 7));
+    num++;
+  }
+  return num;
+}
+static void tilt( int16_t y )
+{
+  hostAccel[0] = 0;
+  hostAccel[1] = y;
+  hostAccel[2] = ONE_G;
+}
+
+/*----------------------------------------------------------------------------*/
+int main( void )
+{
+  uint16_t last = BEND_CENTER;
+  hostKeys = 0;
+  hostPressure = STANDARD_PRS;
+  tilt(0);
+  hostSetup();
+  hostRun(2*RUN_US);    //  power on dead band of AirPressure
+
+  //  silent
+  size_t top = hostMidi.size();
+  tilt(ONE_G/3);
+  hostRun(RUN_US);
+  tilt(-ONE_G/3);
+  hostRun(RUN_US);
+  if ( bendNum(top, &last) != 0 ){ fail("pitch bend while silent");}
+
+  //  playing, tilted up from the posture at the attack
+  hostPressure = STANDARD_PRS + BREATH;
+  hostRun(RUN_US);
+  top = hostMidi.size();
+  tilt(0);
+  hostRun(RUN_US);
+  if (( bendNum(top, &last) == 0 ) || ( last <= BEND_CENTER )){ fail("no pitch bend while playing");}
+  printf("bend while playing: %04x\n", last);
+
+  //  released, then tilted
+  hostPressure = STANDARD_PRS;
+  hostRun(RUN_US);
+  bendNum(top, &last);
+  if ( last != BEND_CENTER ){ fail("pitch bend is not back to the center");}
+  top = hostMidi.size();
+  tilt(ONE_G/3);
+  hostRun(RUN_US);
+  if ( bendNum(top, &last) != 0 ){ fail("pitch bend after the release");}
+
+  printf("%d failures\n", failCount);
+  return ( failCount == 0 )? 0:1;
+}
@@ -0,0 +1,81 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  test_player_state.cpp
+ *    description: Player State Restored from EEPROM ( host )
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#include <stdio.h>
+#include <string.h>
+#include <EEPROM.h>
+#include "host_platform.h"
+#include "host_device.h"
+#include "player_storage.h"
+
+//  The player state is in EEPROM before power on, with the standard
+//  pressure of the sensor. After it is restored:
+//    - nothing is written while the standard stays where it was
+//    - a tone change is still written
+
+/*----------------------------------------------------------------------------*/
+#define   STANDARD_PRS      2000
+#define   TONE_NUMBER       3
+#define   TRANSPOSE         2
+#define   STORE_CHECK_US    130000000UL   //  over two STORE_INTERVAL
+#define   GESTURE_US        100000UL
+
+static int failCount = 0;
+static void fail( const char* what )
+{
+  if ( failCount++ < 20 ){ printf("FAIL at %.3f sec: %s\n", hostMicros/1e6, what);}
+}
+
+/*----------------------------------------------------------------------------*/
+static uint8_t eepromImage[1024];
+static void snapshot( void )
+{
+  for ( int i=0; i<EEPROM.length(); i++ ){ eepromImage[i] = EEPROM.read(i);}
+}
+static bool eepromChanged( void )
+{
+  for ( int i=0; i<EEPROM.length(); i++ ){
+    if ( EEPROM.read(i) != eepromImage[i] ){ return true;}
+  }
+  return false;
+}
+
+/*----------------------------------------------------------------------------*/
+int main( void )
+{
+  //  the state stored before power on
+  PlayerStorage stored;
+  stored.save(TONE_NUMBER, TRANSPOSE, STANDARD_PRS);
+  while ( stored.busy() == true ){ stored.periodic();}
+  snapshot();
+
+  hostKeys = 0;
+  hostPressure = STANDARD_PRS;
+  hostSetup();
+  size_t pc = 0;
+  for ( ; pc<hostMidi.size(); pc++ ){ if ( hostMidi[pc].status == 0xc0 ){ break;}}
+  if (( pc == hostMidi.size() ) || ( hostMidi[pc].data1 != TONE_NUMBER )){ fail("tone is not restored");}
+
+  hostRun(STORE_CHECK_US);
+  if ( eepromChanged() == true ){ fail("the restored state is written again");}
+
+  //  change tone: hold tone key 1 & touch tone key 0
+  hostKeys = 0x02 << 6;
+  hostRun(GESTURE_US);
+  hostKeys = 0x03 << 6;
+  hostRun(GESTURE_US);
+  hostKeys = 0;
+  hostRun(GESTURE_US);
+  if ( eepromChanged() == false ){ fail("a tone change is not written");}
+
+  printf("%.0f sec after the restore, %d failures\n", hostMicros/1e6, failCount);
+  return ( failCount == 0 )? 0:1;
+}
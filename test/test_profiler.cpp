@@ -0,0 +1,117 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  test_profiler.cpp
+ *    description: Profiler Counters & SysEx Dump ( host )
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#include <stdio.h>
+#include "host_platform.h"
+#include "host_device.h"
+#include "profiler.h"
+
+//  Built with USE_PROFILER. On host the probes count 0.5us of the
+//  simulated clock, so a touch scan takes exactly HOST_TOUCH_SCAN_US.
+//    - the dump is sent only for SysEx F0 7D 01 F7, not for a key gesture
+//    - one 21 reply a probe, with the counters of profStat, then cleared
+//    - a touch scan is 2*HOST_TOUCH_SCAN_US counts, in its log2 bin
+
+/*----------------------------------------------------------------------------*/
+#define   STANDARD_PRS      2000
+#define   PLAY_US           2000000UL
+#define   GESTURE_KEYS      0x03c0      //  all four tone/transpose keys
+
+static int failCount = 0;
+static void fail( const char* what )
+{
+  if ( failCount++ < 20 ){ printf("FAIL: %s\n", what);}
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t fromSevenBit( const std::vector<uint8_t>& d, size_t i )
+{
+  return (static_cast<uint32_t>(d[i])<<14) | (static_cast<uint32_t>(d[i+1])<<7) | d[i+2];
+}
+static size_t profileReplies( size_t from )
+{
+  size_t num = 0;
+  for ( size_t i=from; i<hostSysEx.size(); i++ ){
+    if (( hostSysEx[i].data.size() >= 2 ) && ( hostSysEx[i].data[1] == 0x21 )){ num++;}
+  }
+  return num;
+}
+
+/*----------------------------------------------------------------------------*/
+int main( void )
+{
+  hostPressure = STANDARD_PRS;
+  hostKeys = 0;
+  hostSetup();
+  hostRun(PLAY_US);
+  hostPressure = STANDARD_PRS + 600;
+  hostKeys = 0x0005;
+  hostRun(PLAY_US);
+  hostPressure = STANDARD_PRS;
+  hostKeys = 0;
+  hostRun(PLAY_US);
+
+  //  the key gesture of all four keys does not dump any more
+  size_t top = hostSysEx.size();
+  hostKeys = GESTURE_KEYS;
+  hostRun(PLAY_US/4);
+  hostKeys = 0;
+  hostRun(PLAY_US/4);
+  if ( profileReplies(top) != 0 ){ fail("dumped by a key gesture");}
+
+  //  SysEx request
+  ProfileStat before[PROF_MAX];
+  for ( int i=0; i<PROF_MAX; i++ ){ before[i] = profStat[i];}
+  top = hostSysEx.size();
+  hostMidiReceive(hostMicros, 0xf0);
+  hostMidiReceive(hostMicros, 0x7d);
+  hostMidiReceive(hostMicros, 0x01);
+  hostMidiReceive(hostMicros, 0xf7);
+  hostRun(PLAY_US/20);
+
+  if ( profileReplies(top) != PROF_MAX ){ fail("not one reply a probe");}
+  int id = 0;
+  for ( size_t i=top; i<hostSysEx.size(); i++ ){
+    const std::vector<uint8_t>& d = hostSysEx[i].data;
+    if (( d.size() < 2 ) || ( d[1] != 0x21 )){ continue;}
+    if (( d.size() != 15+PROF_HIST_NUM ) || ( d[2] != id )){ fail("broken reply"); break;}
+    const uint32_t min = fromSevenBit(d, 3), max = fromSevenBit(d, 6);
+    const uint32_t mean = fromSevenBit(d, 9), count = fromSevenBit(d, 12);
+
+    //  counted until the request is read
+    if (( count < before[id].count ) || ( max < before[id].max ) ||
+        (( count != 0 ) && (( min > mean ) || ( mean > max )))){
+      fail("counters of the reply differ from profStat");
+    }
+    if ( id == PROF_TOUCH_SCAN ){
+      if (( count == 0 ) || ( min != HOST_TOUCH_SCAN_US*2 ) || ( max != HOST_TOUCH_SCAN_US*2 )){
+        fail("a touch scan is not its simulated time");
+      }
+      int bin = 0;
+      for ( uint32_t tm=(HOST_TOUCH_SCAN_US*2)>>5; ( tm != 0 ) && ( bin < PROF_HIST_NUM-1 ); tm>>=1 ){ bin++;}
+      if ( d[15+bin] != (( count < 0x7f )? count:0x7f )){ fail("a touch scan is not in its bin");}
+    }
+    if (( id == PROF_LOOP ) && (( count == 0 ) || ( max < HOST_TOUCH_SCAN_US*2 ))){
+      fail("loop is not counted");
+    }
+    printf("probe %d: count %5lu min %6.1f max %7.1f mean %6.1f usec\n", id,
+           (unsigned long)count, min/2.0, max/2.0, mean/2.0);
+    id++;
+  }
+
+  //  cleared by the dump
+  for ( int i=0; i<PROF_MAX; i++ ){
+    if ( profStat[i].count >= before[i].count && before[i].count > 100 ){ fail("not cleared");}
+  }
+
+  printf("%d failures\n", failCount);
+  return ( failCount == 0 )? 0:1;
+}
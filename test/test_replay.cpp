@@ -0,0 +1,298 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  test_replay.cpp
+ *    description: Replay of a Trace Capture ( host )
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "host_platform.h"
+#include "trace.h"
+
+//  Built with USE_TRACE_CAPTURE and USE_ADXL345. A session of breath,
+//  keys of chip 0-2, MIDI input and motion is played and its output is
+//  captured. Then a fresh sketch gets its inputs only from the trace
+//  frames of the capture, and must send the same bytes, frames included.
+//  The sketch is a set of globals, so the session runs in a child process.
+
+/*----------------------------------------------------------------------------*/
+#define   STANDARD_PRS      2000
+#define   PLAY_US           20000000UL
+#define   SEGMENT_US        200000UL
+#define   QUIET_US          2000000UL
+
+static const int breathLevel[] = { 0, 60, 300, 600, 1200 };
+
+static uint32_t randState = 1;
+static uint32_t rnd( uint32_t range )
+{
+  //  xorshift32
+  randState ^= randState << 13;
+  randState ^= randState >> 17;
+  randState ^= randState << 5;
+  return randState % range;
+}
+
+/*----------------------------------------------------------------------------*/
+//     Session
+/*----------------------------------------------------------------------------*/
+static void receiveRandomMessage( uint32_t time )
+{
+  switch ( rnd(4) ){
+    case 0: {
+      //  RPN 0/2 coarse tune: transpose, running status
+      const uint8_t msg[7] = { 0xb0, 0x65, 0x00, 0x64, 0x02, 0x06,
+                               static_cast<uint8_t>(64 - 3 + rnd(6)) };
+      for ( int i=0; i<7; i++ ){ hostMidiReceive(time, msg[i]);}
+      break;
+    }
+    case 1:
+      hostMidiReceive(time, 0xc0);
+      hostMidiReceive(time, static_cast<uint8_t>(rnd(8)));
+      break;
+    case 2:
+      //  a beat of MIDI Clock
+      for ( int i=0; i<24; i++ ){ hostMidiReceive(time + i*20833, 0xf8);}
+      break;
+    default:
+      //  other channel, ignored
+      hostMidiReceive(time, 0x91);
+      hostMidiReceive(time, static_cast<uint8_t>(rnd(128)));
+      hostMidiReceive(time, static_cast<uint8_t>(rnd(128)));
+      break;
+  }
+}
+/*----------------------------------------------------------------------------*/
+static uint32_t session( void )
+{
+  hostPressure = STANDARD_PRS;
+  hostSetup();
+  const uint32_t end = hostMicros + PLAY_US;
+  while ( static_cast<int32_t>(hostMicros - end) < 0 ){
+    hostKeys = rnd(64) | (rnd(4) << 6) | (rnd(1024) << 10) | (rnd(1024) << 20);
+    if ( rnd(2) == 0 ){ hostKeys &= 0x3f;}
+    hostPressure = STANDARD_PRS + breathLevel[rnd(sizeof(breathLevel)/sizeof(breathLevel[0]))] +
+                   static_cast<int>(rnd(9)) - 4;
+    for ( int i=0; i<3; i++ ){ hostAccel[i] += static_cast<int16_t>(rnd(2001)) - 1000;}
+    if ( rnd(3) == 0 ){ receiveRandomMessage(hostMicros + rnd(SEGMENT_US));}
+    hostRun(1000 + rnd(SEGMENT_US));
+  }
+  hostKeys = 0;
+  hostPressure = STANDARD_PRS;
+  hostRun(QUIET_US);
+  return hostMicros;
+}
+
+/*----------------------------------------------------------------------------*/
+//     Replay
+/*----------------------------------------------------------------------------*/
+struct Event {
+  uint32_t  time;
+  uint32_t  value[3];
+};
+static std::vector<int>   replayPrs;
+static std::vector<Event> replayTouch;
+static std::vector<Event> replayMotion;
+static size_t prsRead = 0, touchRead = 0, motionRead = 0;
+
+static void replayInput( int in )
+{
+  switch ( in ){
+    case HOST_IN_PRESSURE:
+      if ( prsRead < replayPrs.size() ){ hostPressure = replayPrs[prsRead++];}
+      break;
+    case HOST_IN_TOUCH:
+      while (( touchRead < replayTouch.size() ) &&
+             ( static_cast<int32_t>(replayTouch[touchRead].time - hostMicros) <= 0 )){
+        hostKeys = replayTouch[touchRead++].value[0];
+      }
+      break;
+    case HOST_IN_MOTION:
+      while (( motionRead < replayMotion.size() ) &&
+             ( static_cast<int32_t>(replayMotion[motionRead].time - hostMicros) <= 0 )){
+        for ( int i=0; i<3; i++ ){
+          hostAccel[i] = static_cast<int16_t>(replayMotion[motionRead].value[i]);
+        }
+        motionRead++;
+      }
+      break;
+    default: break;
+  }
+}
+/*----------------------------------------------------------------------------*/
+static uint32_t sevenBit( const uint8_t* p, int num )
+{
+  uint32_t v = 0;
+  for ( int i=0; i<num; i++ ){ v |= static_cast<uint32_t>(p[i]) << (i*7);}
+  return v;
+}
+/*----------------------------------------------------------------------------*/
+//  returns false if a frame is lost or broken
+static bool decodeFrame( const std::vector<uint8_t>& f, uint32_t& start, int& seq )
+{
+  if (( f.size() < 8 ) || ( f[0] != 0x7d ) || ( f[1] != 0x02 )){ return true;}   //  not a frame
+  if (( seq >= 0 ) && ( f[2] != ((seq+1) & 0x7f) )){ return false;}
+  seq = f[2];
+  start += (sevenBit(&f[5], 3) - start) & 0x1fffff;
+
+  int prs = -1;
+  size_t i = 8;
+  while ( i < f.size() ){
+    const uint8_t e = f[i];
+    if ( e <= TRACE_PRS_DELTA_MAX ){
+      if ( prs < 0 ){ return false;}
+      prs += e - 32;
+      replayPrs.push_back(prs);
+      i += 1;
+      continue;
+    }
+    if ( e == TRACE_PRS_ABSOLUTE ){
+      if ( i+3 > f.size() ){ return false;}
+      prs = (f[i+1]<<7) | f[i+2];
+      replayPrs.push_back(prs);
+      i += 3;
+      continue;
+    }
+    if ( i+3 > f.size() ){ return false;}
+    const uint32_t time = start + sevenBit(&f[i+1], 2);
+    i += 3;
+    Event ev = { time, { 0, 0, 0 } };
+    switch ( e ){
+      case TRACE_TOUCH_WORD:
+        if ( i+5 > f.size() ){ return false;}
+        ev.value[0] = sevenBit(&f[i], 5);
+        replayTouch.push_back(ev);
+        i += 5;
+        break;
+      case TRACE_RX_DATA:
+      case TRACE_RX_STATUS:
+        if ( i+1 > f.size() ){ return false;}
+        hostMidiReceive(time, ( e == TRACE_RX_STATUS )? (f[i] | 0x80):f[i]);
+        i += 1;
+        break;
+      case TRACE_MOTION_SAMPLE:
+        if ( i+9 > f.size() ){ return false;}
+        for ( int j=0; j<3; j++ ){ ev.value[j] = sevenBit(&f[i+j*3], 3) & 0xffff;}
+        replayMotion.push_back(ev);
+        i += 9;
+        break;
+      default: return false;
+    }
+  }
+  return true;
+}
+
+/*----------------------------------------------------------------------------*/
+//     pipe between the processes
+/*----------------------------------------------------------------------------*/
+static void writeAll( int fd, const void* data, size_t size )
+{
+  const char* p = static_cast<const char*>(data);
+  while ( size > 0 ){
+    const ssize_t n = write(fd, p, size);
+    if ( n <= 0 ){ _exit(2);}
+    p += n; size -= n;
+  }
+}
+static bool readAll( int fd, void* data, size_t size )
+{
+  char* p = static_cast<char*>(data);
+  while ( size > 0 ){
+    const ssize_t n = read(fd, p, size);
+    if ( n <= 0 ){ return false;}
+    p += n; size -= n;
+  }
+  return true;
+}
+
+/*----------------------------------------------------------------------------*/
+int main( int argc, char* argv[] )
+{
+  randState = ( argc > 1 )? static_cast<uint32_t>(strtoul(argv[1], 0, 0)):1;
+  if ( randState == 0 ){ randState = 1;}
+
+  int fd[2];
+  if ( pipe(fd) != 0 ){ return 2;}
+  const pid_t pid = fork();
+  if ( pid < 0 ){ return 2;}
+
+  if ( pid == 0 ){
+    close(fd[0]);
+    const uint32_t end = session();
+    const uint32_t num = static_cast<uint32_t>(hostTx.size());
+    writeAll(fd[1], &end, sizeof(end));
+    writeAll(fd[1], &num, sizeof(num));
+    writeAll(fd[1], hostTx.data(), num*sizeof(HostByte));
+    close(fd[1]);
+    _exit(0);
+  }
+
+  close(fd[1]);
+  uint32_t end = 0, num = 0;
+  std::vector<HostByte> capture;
+  bool received = readAll(fd[0], &end, sizeof(end)) && readAll(fd[0], &num, sizeof(num));
+  if ( received == true ){
+    capture.resize(num);
+    received = readAll(fd[0], capture.data(), num*sizeof(HostByte));
+  }
+  close(fd[0]);
+  int status = 0;
+  waitpid(pid, &status, 0);
+  if (( received == false ) || ( WIFEXITED(status) == 0 ) || ( WEXITSTATUS(status) != 0 )){
+    printf("FAIL: session\n");
+    return 1;
+  }
+
+  //  inputs from the frames only
+  uint32_t start = 0;
+  int seq = -1;
+  size_t frameNum = 0;
+  std::vector<uint8_t> sysEx;
+  bool inSysEx = false;
+  for ( size_t i=0; i<capture.size(); i++ ){
+    const uint8_t dt = capture[i].dt;
+    if ( dt >= 0xf8 ){ continue;}
+    if ( dt == 0xf0 ){ sysEx.clear(); inSysEx = true; continue;}
+    if ( inSysEx == false ){ continue;}
+    if (( dt & 0x80 ) == 0 ){ sysEx.push_back(dt); continue;}
+    inSysEx = false;
+    if ( decodeFrame(sysEx, start, seq) == false ){
+      printf("FAIL: trace frame %lu is lost or broken\n", (unsigned long)frameNum);
+      return 1;
+    }
+    frameNum++;
+  }
+
+  hostInputHook = replayInput;
+  hostPressure = STANDARD_PRS;
+  hostKeys = 0;
+  hostAccel[0] = 0; hostAccel[1] = 0; hostAccel[2] = 16384;
+  hostSetup();
+  while ( static_cast<int32_t>(hostMicros - end) < 0 ){ hostLoop();}
+
+  size_t diff = 0;
+  while (( diff < capture.size() ) && ( diff < hostTx.size() ) && ( capture[diff].dt == hostTx[diff].dt )){
+    diff++;
+  }
+  const bool same = ( diff == capture.size() ) && ( diff == hostTx.size() );
+  if ( same == false ){
+    printf("FAIL: replay differs at byte %lu of %lu ( %lu replayed ), %.3f sec\n",
+           (unsigned long)diff, (unsigned long)capture.size(), (unsigned long)hostTx.size(),
+           ( diff < capture.size() )? capture[diff].time/1e6:0.0);
+    for ( size_t i=( diff > 8 )? diff-8:0; ( i < diff+8 ) && ( i < capture.size() ) && ( i < hostTx.size() ); i++ ){
+      printf("  %6lu: %02x %02x\n", (unsigned long)i, capture[i].dt, hostTx[i].dt);
+    }
+  }
+  printf("%lu bytes, %lu frames: %lu samples, %lu touch, %lu motion, replayed %s\n",
+         (unsigned long)capture.size(), (unsigned long)frameNum, (unsigned long)replayPrs.size(),
+         (unsigned long)replayTouch.size(), (unsigned long)replayMotion.size(),
+         same? "byte-identical":"with a difference");
+  return same? 0:1;
+}
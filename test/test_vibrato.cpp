@@ -0,0 +1,87 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  test_vibrato.cpp
+ *    description: Vibrato & Growl Detector with Synthetic Breath ( host )
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#include <stdio.h>
+#include <math.h>
+#include "air_pressure.h"
+
+//  Synthetic raw samples at the period of PressureDevice, built once
+//  for each sensor rate ( HOST_PRS_PERIOD_US ) by Makefile.
+//  Depth and rate must not depend on the sample period.
+
+/*----------------------------------------------------------------------------*/
+#define   STANDARD_PRS    3000
+#define   RUN_MS          3000
+
+static int failCount = 0;
+
+/*----------------------------------------------------------------------------*/
+static void run( Vibrato& vb, double vibHz, double vibAmp, double growlHz, double growlAmp )
+{
+  const double pi = 3.14159265358979;
+  const uint32_t period = PRS_SAMPLE_PERIOD_US;
+  vb.reset();
+  for ( uint32_t us=0; us<RUN_MS*1000UL; us+=period ){
+    const double t = us/1000000.0;
+    const double prs = STANDARD_PRS + vibAmp*sin(2*pi*vibHz*t) + growlAmp*sin(2*pi*growlHz*t);
+    vb.addSample(static_cast<int>(lround(prs)), static_cast<uint16_t>(us/1000));
+  }
+}
+/*----------------------------------------------------------------------------*/
+static void check( bool ok, const char* what, int value )
+{
+  printf("  %-36s %4d  %s\n", what, value, ok? "ok":"FAIL");
+  if ( !ok ){ failCount++;}
+}
+/*----------------------------------------------------------------------------*/
+int main( void )
+{
+  static Vibrato vb;
+  const uint32_t period = PRS_SAMPLE_PERIOD_US;
+  printf("sample period %lu usec\n", (unsigned long)period);
+
+  run(vb, 5.0, 30.0, 0, 0);
+  check(( vb.depth() >= 15 ) && ( vb.depth() <= 35 ), "5Hz +-30: depth", vb.depth());
+  check(( vb.rate() >= 45 ) && ( vb.rate() <= 55 ), "5Hz +-30: rate [0.1Hz]", vb.rate());
+  check( vb.growlDepth() == 0, "5Hz +-30: growl", vb.growlDepth());
+
+  run(vb, 3.5, 30.0, 0, 0);
+  check(( vb.depth() >= 15 ) && ( vb.depth() <= 35 ), "3.5Hz +-30: depth", vb.depth());
+
+  //  a period is measured in samples, 25Hz ODR resolves up to about 6Hz
+  if ( period*4 < 1000000UL/7.5 ){
+    run(vb, 7.5, 30.0, 0, 0);
+    check(( vb.depth() >= 10 ) && ( vb.depth() <= 35 ), "7.5Hz +-30: depth", vb.depth());
+  }
+  else {
+    run(vb, 6.0, 30.0, 0, 0);
+    check(( vb.depth() >= 10 ) && ( vb.depth() <= 35 ), "6Hz +-30: depth", vb.depth());
+  }
+
+  run(vb, 12.0, 30.0, 0, 0);
+  check( vb.depth() == 0, "12Hz +-30: depth", vb.depth());
+
+  run(vb, 1.0, 30.0, 0, 0);
+  check( vb.depth() == 0, "1Hz +-30: depth", vb.depth());
+
+  run(vb, 0, 0, 0, 0);
+  check(( vb.depth() == 0 ) && ( vb.growlDepth() == 0 ), "steady: depth and growl", vb.depth());
+
+  //  growl needs twice its frequency
+  if ( period*2 <= 1000000UL/60 ){
+    run(vb, 5.0, 30.0, 60.0, 8.0);
+    check( vb.growlDepth() >= 8, "60Hz +-8 over vibrato: growl", vb.growlDepth());
+    check(( vb.depth() >= 15 ) && ( vb.depth() <= 35 ), "60Hz +-8 over vibrato: depth", vb.depth());
+  }
+
+  printf("%d failures\n", failCount);
+  return ( failCount == 0 )? 0:1;
+}
@@ -0,0 +1,126 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  trace.cpp
+ *    description: Sensor Trace Capture
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#include "trace.h"
+#include "TouchMIDI_AVR_if.h"
+
+#ifdef USE_TRACE_CAPTURE
+#define TRACE_TIME_MAX      0x3fff
+
+static uint8_t  traceBuf[TRACE_BUF_MAX];
+static uint8_t  traceLength = TRACE_HEADER_SIZE;
+static uint8_t  traceSeq = 0;
+static uint16_t traceTick = 0;
+static uint32_t traceStart = 0;         //  micros() at the tick
+static int16_t  traceLastPrs = -1;      //  -1: next sample is absolute
+static uint32_t traceLastKeys = 0xffffffff;
+static int16_t  traceLastAcc[3] = { 0x7fff, 0x7fff, 0x7fff };
+static_assert( sizeof(traceBuf) + sizeof(traceLength) + sizeof(traceSeq) + sizeof(traceTick) +
+               sizeof(traceStart) + sizeof(traceLastPrs) + sizeof(traceLastKeys) + sizeof(traceLastAcc)
+               == TRACE_RAM, "TRACE_RAM differs from the statics" );
+
+/*----------------------------------------------------------------------------*/
+static void flushFrame( void )
+{
+  if ( traceLength <= TRACE_HEADER_SIZE ){ return;}
+
+  traceBuf[0] = 0x7d;
+  traceBuf[1] = 0x02;
+  traceBuf[2] = traceSeq;
+  traceBuf[3] = traceTick & 0x7f;
+  traceBuf[4] = (traceTick>>7) & 0x7f;
+  traceBuf[5] = traceStart & 0x7f;
+  traceBuf[6] = (traceStart>>7) & 0x7f;
+  traceBuf[7] = (traceStart>>14) & 0x7f;
+  setMidiSysEx( traceBuf, traceLength );
+
+  traceSeq = (traceSeq+1) & 0x7f;
+  traceLength = TRACE_HEADER_SIZE;
+  traceLastPrs = -1;      //  every frame can be replayed from its top
+}
+/*----------------------------------------------------------------------------*/
+static inline void reserve( uint8_t size )
+{
+  if ( traceLength + size > TRACE_BUF_MAX ){ flushFrame();}
+}
+/*----------------------------------------------------------------------------*/
+//  the time is taken before reserve(), which may wait for MIDI output
+static void putTimedEntry( uint8_t entry, uint32_t readTime )
+{
+  uint32_t tm = readTime - traceStart;
+  if ( tm > TRACE_TIME_MAX ){ tm = TRACE_TIME_MAX;}
+  traceBuf[traceLength++] = entry;
+  traceBuf[traceLength++] = tm & 0x7f;
+  traceBuf[traceLength++] = (tm>>7) & 0x7f;
+}
+/*----------------------------------------------------------------------------*/
+//
+//     Call on 10msec event before reading sensors
+//
+/*----------------------------------------------------------------------------*/
+void trace_tick( uint32_t tick )
+{
+  flushFrame();
+  traceTick = static_cast<uint16_t>(tick);
+  traceStart = micros();
+}
+/*----------------------------------------------------------------------------*/
+void trace_pressure( int raw )
+{
+  reserve(3);
+  const int diff = raw - traceLastPrs;
+  if (( traceLastPrs >= 0 ) && ( diff >= -32 ) && ( diff <= 31 )){
+    traceBuf[traceLength++] = static_cast<uint8_t>(diff + 32);
+  }
+  else {
+    traceBuf[traceLength++] = TRACE_PRS_ABSOLUTE;
+    traceBuf[traceLength++] = (raw>>7) & 0x7f;
+    traceBuf[traceLength++] = raw & 0x7f;
+  }
+  traceLastPrs = static_cast<int16_t>(raw);
+}
+/*----------------------------------------------------------------------------*/
+void trace_touch( uint32_t keys )
+{
+  if ( keys == traceLastKeys ){ return;}
+  const uint32_t tm = micros();
+  reserve(8);
+  putTimedEntry(TRACE_TOUCH_WORD, tm);
+  for ( int i=0; i<5; i++ ){
+    traceBuf[traceLength++] = static_cast<uint8_t>(keys >> (i*7)) & 0x7f;
+  }
+  traceLastKeys = keys;
+}
+/*----------------------------------------------------------------------------*/
+void trace_midiRx( uint8_t dt )
+{
+  const uint32_t tm = micros();
+  reserve(4);
+  putTimedEntry(( dt & 0x80 )? TRACE_RX_STATUS:TRACE_RX_DATA, tm);
+  traceBuf[traceLength++] = dt & 0x7f;
+}
+/*----------------------------------------------------------------------------*/
+void trace_motion( const signed short* acc )
+{
+  if (( acc[0] == traceLastAcc[0] ) && ( acc[1] == traceLastAcc[1] ) &&
+      ( acc[2] == traceLastAcc[2] )){ return;}
+  const uint32_t tm = micros();
+  reserve(12);
+  putTimedEntry(TRACE_MOTION_SAMPLE, tm);
+  for ( int i=0; i<3; i++ ){
+    const uint16_t a = static_cast<uint16_t>(acc[i]);
+    traceBuf[traceLength++] = a & 0x7f;
+    traceBuf[traceLength++] = (a>>7) & 0x7f;
+    traceBuf[traceLength++] = (a>>14) & 0x7f;
+    traceLastAcc[i] = acc[i];
+  }
+}
+#endif
@@ -0,0 +1,68 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  trace.h
+ *    description: Sensor Trace Capture
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+#include "configuration.h"
+
+//  Trace Frame ( SysEx, interleaved with MIDI output in the same stream )
+//    F0 7D 02 seq tickL tickH us0 us1 us2 entry... F7
+//      seq   : frame counter (0-127) to find a lost frame
+//      tick  : 10msec tick when the samples were read (low 14bit)
+//      us    : micros() at the tick (low 21bit, 7bit each, LSB first)
+//    entry ( in loop order )
+//      00-3F : pressure, delta from the previous sample (-32..31)
+//      40 hi lo : pressure, absolute 14bit (first sample of frame)
+//      41 t0 t1 k0-k4 : key word of chip 0-2 (30bit), when it changed
+//        multi-byte values are 7bit each, LSB first
+//      42 t0 t1 dt : MIDI RX data byte
+//      43 t0 t1 dt : MIDI RX status byte, without bit 7
+//      44 t0 t1 x0-x2 y0-y2 z0-z2 : ADXL345 sample (16bit), when it changed
+//        t : micros() of the read since the tick (14bit)
+//  Every input of loop() is in the frame with the time it was read, so
+//  the host simulation ( test/ ) replays a capture to the same MIDI bytes.
+//  A sensor error is not in the frame and is not replayed.
+#define TRACE_PRS_DELTA_MAX   0x3f
+#define TRACE_PRS_ABSOLUTE    0x40
+#define TRACE_TOUCH_WORD      0x41
+#define TRACE_RX_DATA         0x42
+#define TRACE_RX_STATUS       0x43
+#define TRACE_MOTION_SAMPLE   0x44
+
+#define TRACE_HEADER_SIZE     8
+#define TRACE_BUF_MAX         (TRACE_HEADER_SIZE+24)
+//  static RAM of trace.cpp: the frame, its length, seq and tick,
+//  traceStart, and the last pressure, keys and acceleration
+#define TRACE_RAM             (TRACE_BUF_MAX + 1 + 1 + 2 + 4 + 2 + 4 + 6)
+
+#ifdef USE_TRACE_CAPTURE
+void trace_tick( uint32_t tick );
+void trace_pressure( int raw );
+void trace_touch( uint32_t keys );
+void trace_midiRx( uint8_t dt );
+void trace_motion( const signed short* acc );
+
+  #define TRACE_TICK(t)       trace_tick(t)
+  #define TRACE_PRESSURE(p)   trace_pressure(p)
+  #define TRACE_TOUCH(k)      trace_touch(k)
+  #define TRACE_MIDI_RX(d)    trace_midiRx(d)
+  #define TRACE_MOTION(a)     trace_motion(a)
+#else
+  #define TRACE_TICK(t)
+  #define TRACE_PRESSURE(p)
+  #define TRACE_TOUCH(k)
+  #define TRACE_MIDI_RX(d)
+  #define TRACE_MOTION(a)
+#endif
+
+#endif
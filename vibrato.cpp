@@ -0,0 +1,116 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  vibrato.cpp
+ *    description: Breath Vibrato & Growl Detector
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#include "vibrato.h"
+#include "product.h"
+
+/*----------------------------------------------------------------------------*/
+//  shift of a one-pole filter for the time constant, nearest in log2
+//  ( compile time only )
+constexpr unsigned long long square( unsigned long long x ){ return x*x;}
+constexpr int filterShift( uint32_t tcUs, uint32_t periodUs, int shift=0 )
+{
+  return ( 2*square(static_cast<unsigned long long>(periodUs)<<shift) >= square(tcUs) )?
+         shift:filterShift(tcUs, periodUs, shift+1);
+}
+constexpr uint16_t maxPeriod( uint16_t a, uint16_t b ){ return ( a > b )? a:b;}
+
+//  filters are set by the sample period of the pressure sensor
+#define   SAMPLE_PERIOD_US    PressureDevice::SAMPLE_PERIOD_US
+
+const int Vibrato::DC_FRAC_BITS = 4;
+const int Vibrato::DC_SHIFT = filterShift(160000, SAMPLE_PERIOD_US);     //  160msec ( about 1Hz )
+const int Vibrato::LOW_PASS_SHIFT = filterShift(20000, SAMPLE_PERIOD_US); //  20msec ( about 8Hz )
+const int Vibrato::VIB_HYSTERESIS = 6;        //  raw sensor count
+const uint16_t Vibrato::VIB_PERIOD_MIN = 125; //  8Hz
+const uint16_t Vibrato::VIB_PERIOD_MAX = 333; //  3Hz
+const int Vibrato::VIB_DEPTH_SHIFT = 1;       //  256 peak to peak -> 127
+const int Vibrato::GROWL_HYSTERESIS = 4;
+//  200Hz, or the Nyquist frequency of a slow sensor
+const uint16_t Vibrato::GROWL_PERIOD_MIN = maxPeriod(5, 2*SAMPLE_PERIOD_US/1000);
+const uint16_t Vibrato::GROWL_PERIOD_MAX = 40;  //  25Hz
+
+/*----------------------------------------------------------------------------*/
+//
+//     Band split & zero crossing
+//
+/*----------------------------------------------------------------------------*/
+void Vibrato::addSample( int prs, uint16_t tm )
+{
+  if ( _valid == false ){
+    _dc = static_cast<int32_t>(prs) << DC_FRAC_BITS;
+    _lowPass = 0;
+    _lastPrs = prs;
+    _vibrato.max = _vibrato.min = _growl.max = _growl.min = 0;
+    _vibrato.lastTime = _growl.lastTime = tm;
+    _vibrato.positive = _growl.positive = false;
+    _valid = true;
+    return;
+  }
+
+  //  filters keep fraction, otherwise truncation makes a DC offset
+  const int32_t highPass = (static_cast<int32_t>(prs) << DC_FRAC_BITS) - _dc;
+  _dc += highPass >> DC_SHIFT;
+  _lowPass += (highPass - _lowPass) >> LOW_PASS_SHIFT;
+  const int vibSig = static_cast<int>(_lowPass >> DC_FRAC_BITS);
+  const int growlSig = prs - _lastPrs;     //  difference cuts vibrato band
+  _lastPrs = prs;
+
+  //  Vibrato
+  uint16_t period = detectCrossing(_vibrato, vibSig, VIB_HYSTERESIS, tm);
+  if ( period != 0 ){
+    if (( period >= VIB_PERIOD_MIN ) && ( period <= VIB_PERIOD_MAX )){
+      int depth = (_vibrato.max - _vibrato.min) >> VIB_DEPTH_SHIFT;
+      if ( depth > 127 ){ depth = 127;}
+      _depth = static_cast<uint8_t>((_depth + depth + 1) >> 1);
+      _rate = static_cast<uint8_t>(10000/period);   //  once a cycle
+    }
+    else { _depth = 0;}
+    _vibrato.max = _vibrato.min = 0;
+  }
+  else if ( static_cast<uint16_t>(tm - _vibrato.lastTime) > VIB_PERIOD_MAX ){
+    _depth = 0;
+  }
+
+  //  Growl
+  period = detectCrossing(_growl, growlSig, GROWL_HYSTERESIS, tm);
+  if ( period != 0 ){
+    if (( period >= GROWL_PERIOD_MIN ) && ( period <= GROWL_PERIOD_MAX )){
+      int depth = _growl.max - _growl.min;
+      if ( depth > 127 ){ depth = 127;}
+      _growlDepth = static_cast<uint8_t>((_growlDepth + depth + 1) >> 1);
+    }
+    else { _growlDepth = 0;}
+    _growl.max = _growl.min = 0;
+  }
+  else if ( static_cast<uint16_t>(tm - _growl.lastTime) > GROWL_PERIOD_MAX ){
+    _growlDepth = 0;
+  }
+}
+//-------------------------------------------------------------------------
+uint16_t Vibrato::detectCrossing( Crossing& cr, int sig, int hysteresis, uint16_t tm )
+{
+  if ( sig > cr.max ){ cr.max = sig;}
+  if ( sig < cr.min ){ cr.min = sig;}
+
+  if ( cr.positive == false ){
+    if ( sig > hysteresis ){
+      cr.positive = true;
+      const uint16_t period = tm - cr.lastTime;
+      cr.lastTime = tm;
+      return ( period == 0 )? 1:period;
+    }
+  }
+  else if ( sig < -hysteresis ){
+    cr.positive = false;
+  }
+  return 0;
+}
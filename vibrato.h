@@ -0,0 +1,64 @@
+/* ========================================
+ *
+ *  TouchMIDI Common Platform for AVR
+ *  vibrato.h
+ *    description: Breath Vibrato & Growl Detector
+ *
+ *  Copyright(c)2019- Masahiko Hasebe at Kigakudoh
+ *  This software is released under the MIT License, see LICENSE.txt
+ *
+ * ========================================
+ */
+#ifndef VIBRATO_H
+#define VIBRATO_H
+
+#include <Arduino.h>
+
+//  Zero crossing of the high passed raw pressure ( called every sample )
+//    vibrato band ( 3 - 8Hz ) : low pass of high pass
+//    growl band ( 25 - 200Hz ) : difference of samples
+//    only shifts, adds and compares per sample
+class Vibrato {
+
+public:
+  Vibrato( void ) : _dc(0), _lowPass(0), _lastPrs(0), _vibrato(), _growl(),
+    _depth(0), _rate(0), _growlDepth(0), _valid(false) {}
+
+  void      reset( void ){ _valid = false; _depth = _growlDepth = 0;}
+  void      addSample( int prs, uint16_t tm );    //  tm: msec
+  uint8_t   depth( void ) const { return _depth;}         //  0 - 127
+  uint8_t   rate( void ) const { return _rate;}           //  0.1Hz
+  uint8_t   growlDepth( void ) const { return _growlDepth;} //  0 - 127
+
+private:
+  struct Crossing {
+    int       max;
+    int       min;
+    uint16_t  lastTime;
+    bool      positive;
+  };
+  //  returns period [msec] at rising edge, or 0
+  static uint16_t detectCrossing( Crossing& cr, int sig, int hysteresis, uint16_t tm );
+
+  static const int DC_FRAC_BITS;
+  static const int DC_SHIFT;
+  static const int LOW_PASS_SHIFT;
+  static const int VIB_HYSTERESIS;
+  static const uint16_t VIB_PERIOD_MIN;
+  static const uint16_t VIB_PERIOD_MAX;
+  static const int VIB_DEPTH_SHIFT;
+  static const int GROWL_HYSTERESIS;
+  static const uint16_t GROWL_PERIOD_MIN;
+  static const uint16_t GROWL_PERIOD_MAX;
+
+  int32_t   _dc;          //  fixed point: DC_FRAC_BITS
+  int32_t   _lowPass;     //  fixed point: DC_FRAC_BITS
+  int       _lastPrs;
+  Crossing  _vibrato;
+  Crossing  _growl;
+  uint8_t   _depth;
+  uint8_t   _rate;
+  uint8_t   _growlDepth;
+  bool      _valid;
+};
+#endif